@@ -27,6 +27,7 @@
 #include "art/Framework/Principal/SubRun.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Principal/View.h"
+#include "art/Utilities/Globals.h"
 #include "canvas/Persistency/Common/Ptr.h"
 #include "canvas/Persistency/Common/PtrVector.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
@@ -100,14 +101,25 @@
 #include <functional> // std::mem_fun_ref
 #include <typeinfo>
 #include <memory> // std::unique_ptr<>
+#include <optional>
+#include <unordered_map>
+#include <cstdint> // std::int64_t, std::uint64_t
+#include <chrono>
+#include <iomanip> // std::setw()
+#include <sys/resource.h> // getrusage()
 
 #include "TTree.h"
+#include "TLeaf.h"
+#include "TFile.h"
+#include "TROOT.h" // ROOT::EnableImplicitMT()
 #include "TTimeStamp.h"
+#include "RVersion.h"
+#include "ROOT/RNTupleModel.hxx"
+#include "ROOT/RNTupleWriter.hxx"
 
 #define MVA_LENGTH 4
 
 constexpr int kNplanes       = 3;     //number of wire planes
-constexpr int kMaxHits       = 100000; //maximum number of hits;
 constexpr int kMaxTrackHits  = 2000;  //maximum number of hits on a track
 constexpr int kMaxTrackers   = 15;    //number of trackers passed into fTrackModuleLabel
 constexpr int kMaxVertices   = 500;    //max number of 3D vertices
@@ -537,36 +549,36 @@ namespace dune {
     Double_t     potnumitgt;         //pot per event (NuMI E:TORTGT)
     Double_t     potnumi101;         //pot per event (NuMI E:TOR101)
 
-    // hit information (non-resizeable, 45x kMaxHits = 900k bytes worth)
+    // hit information (resized to the number of hits in each event)
     Int_t    no_hits;                  //number of hits
     Int_t    no_hits_stored;                  //number of hits actually stored in the tree
-    Short_t  hit_tpc[kMaxHits];        //tpc number
-    Short_t  hit_plane[kMaxHits];      //plane number
-    Short_t  hit_wire[kMaxHits];       //wire number
-    Short_t  hit_channel[kMaxHits];    //channel ID
-    Float_t  hit_peakT[kMaxHits];      //peak time
-    Float_t  hit_charge[kMaxHits];     //charge (area)
-    Float_t  hit_ph[kMaxHits];         //amplitude
-    Float_t  hit_startT[kMaxHits];     //hit start time
-    Float_t  hit_endT[kMaxHits];       //hit end time
-    Float_t  hit_rms[kMaxHits];       //hit rms from the hit object
-    Float_t  hit_goodnessOfFit[kMaxHits]; //chi2/dof goodness of fit
-    Short_t  hit_multiplicity[kMaxHits];  //multiplicity of the given hit
-    Float_t  hit_trueX[kMaxHits];      // hit true X (cm)
-    Float_t  hit_nelec[kMaxHits];     //hit number of electrons
-    Float_t  hit_energy[kMaxHits];       //hit energy
-    Short_t  hit_trkid[kMaxHits];      //is this hit associated with a reco track?
-    Short_t  hit_trkKey[kMaxHits];      //is this hit associated with a reco track,  if so associate a unique track key ID?
-    Short_t  hit_clusterid[kMaxHits];  //is this hit associated with a reco cluster?
-    Short_t  hit_clusterKey[kMaxHits];  //is this hit associated with a reco cluster, if so associate a unique cluster key ID?
-    Short_t  hit_spacepointid[kMaxHits];
-    Short_t  hit_spacepointKey[kMaxHits];
-
-    Float_t rawD_ph[kMaxHits];
-    Float_t rawD_peakT[kMaxHits];
-    Float_t rawD_charge[kMaxHits];
-    Float_t rawD_fwhh[kMaxHits];
-    Double_t rawD_rms[kMaxHits];
+    std::vector<Short_t> hit_tpc;        //tpc number
+    std::vector<Short_t> hit_plane;      //plane number
+    std::vector<Short_t> hit_wire;       //wire number
+    std::vector<Short_t> hit_channel;    //channel ID
+    std::vector<Float_t> hit_peakT;      //peak time
+    std::vector<Float_t> hit_charge;     //charge (area)
+    std::vector<Float_t> hit_ph;         //amplitude
+    std::vector<Float_t> hit_startT;     //hit start time
+    std::vector<Float_t> hit_endT;       //hit end time
+    std::vector<Float_t> hit_rms;       //hit rms from the hit object
+    std::vector<Float_t> hit_goodnessOfFit; //chi2/dof goodness of fit
+    std::vector<Short_t> hit_multiplicity;  //multiplicity of the given hit
+    std::vector<Float_t> hit_trueX;      // hit true X (cm)
+    std::vector<Float_t> hit_nelec;     //hit number of electrons (true, within the hit's time window)
+    std::vector<Float_t> hit_energy;       //hit energy (true, within the hit's time window)
+    std::vector<Short_t> hit_trkid;      //is this hit associated with a reco track?
+    std::vector<Short_t> hit_trkKey;      //is this hit associated with a reco track,  if so associate a unique track key ID?
+    std::vector<Short_t> hit_clusterid;  //is this hit associated with a reco cluster?
+    std::vector<Short_t> hit_clusterKey;  //is this hit associated with a reco cluster, if so associate a unique cluster key ID?
+    std::vector<Short_t> hit_spacepointid;
+    std::vector<Short_t> hit_spacepointKey;
+
+    std::vector<Float_t> rawD_ph;
+    std::vector<Float_t> rawD_peakT;
+    std::vector<Float_t> rawD_charge;
+    std::vector<Float_t> rawD_fwhh;
+    std::vector<Double_t> rawD_rms;
 
     //Pandora Nu Vertex information
     Short_t nnuvtx;
@@ -1128,6 +1140,9 @@ namespace dune {
     /// Resize the data structure for SpacePointSolver
     void ResizeSpacePointSolver(int nSpacePoints);
 
+    /// Resize the data structure for hits (and their raw digit information)
+    void ResizeHits(int nHits);
+
     /// Connect this object with a tree
     void SetAddresses(
                       TTree* pTree,
@@ -1148,7 +1163,7 @@ namespace dune {
     size_t GetNShowerAlgos() const { return ShowerData.size(); }
 
     /// Returns the number of hits for which memory is allocated
-    size_t GetMaxHits() const { return kMaxHits; }
+    size_t GetMaxHits() const { return hit_tpc.capacity(); }
 
     /// Returns the number of trackers for which memory is allocated
     size_t GetMaxTrackers() const { return TrackData.capacity(); }
@@ -1264,6 +1279,194 @@ namespace dune {
   { using type = typename std::vector<T>::value_type; };
 
 
+  /**
+   * @brief Accumulates the time spent in blocks of code over the whole job
+   *
+   * Each block is measured by the Scope returned by Measure(), which records
+   * the elapsed time and the growth of the peak resident memory of the process
+   * when it is destroyed (or stopped). When the profiler is disabled, scopes
+   * do nothing.
+   *
+   * The peak memory is a process-wide quantity: its growth is only meaningful
+   * when the job runs a single schedule (otherwise it includes whatever other
+   * modules allocated in the meanwhile), and the growth in a nested block is
+   * counted also in the block containing it (e.g. "truth/..." in "truth").
+   */
+  class AnalysisTreeProfiler {
+  public:
+
+    /// Statistics accumulated for a single block
+    struct BlockStats_t {
+      std::string name;
+      unsigned long calls = 0;
+      double seconds = 0.;
+      long processMaxRSSgrowth = 0; ///< growth of the process-wide peak memory [kB]
+    }; // BlockStats_t
+
+    /// Measures one block from construction to destruction or Stop()
+    class Scope {
+    public:
+      Scope(AnalysisTreeProfiler* profiler, char const* name)
+        : fProfiler(profiler), fName(name)
+      {
+        if (!fProfiler) return;
+        fStartMaxRSS = MaxRSS();
+        fStart = std::chrono::steady_clock::now();
+      }
+      Scope(Scope const&) = delete;
+      Scope& operator= (Scope const&) = delete;
+      ~Scope() { Stop(); }
+
+      /// Records the block now; later calls (and destruction) do nothing
+      void Stop()
+      {
+        if (!fProfiler) return;
+        std::chrono::duration<double> const elapsed
+          = std::chrono::steady_clock::now() - fStart;
+        fProfiler->Record(fName, elapsed.count(), MaxRSS() - fStartMaxRSS);
+        fProfiler = nullptr;
+      }
+
+    private:
+      AnalysisTreeProfiler* fProfiler; ///< nullptr if not measuring
+      char const* fName;
+      std::chrono::steady_clock::time_point fStart;
+      long fStartMaxRSS = 0;
+    }; // Scope
+
+    explicit AnalysisTreeProfiler(bool enabled): fEnabled(enabled) {}
+
+    bool Enabled() const { return fEnabled; }
+
+    /// Returns a scope measuring the block with the specified name
+    Scope Measure(char const* name) { return { fEnabled? this: nullptr, name }; }
+
+    /// Returns the statistics of all the blocks, in order of first appearance
+    std::vector<BlockStats_t> const& Stats() const { return fStats; }
+
+    /// Returns the peak resident memory of the process so far [kB]
+    static long MaxRSS()
+    {
+      rusage usage;
+      return (getrusage(RUSAGE_SELF, &usage) == 0)? usage.ru_maxrss: 0;
+    }
+
+  private:
+    bool fEnabled;
+    std::vector<BlockStats_t> fStats;
+
+    void Record(char const* name, double seconds, long processMaxRSSgrowth)
+    {
+      auto iStats = std::find_if(fStats.begin(), fStats.end(),
+        [name](BlockStats_t const& stats){ return stats.name == name; });
+      if (iStats == fStats.end()) {
+        fStats.emplace_back();
+        iStats = std::prev(fStats.end());
+        iStats->name = name;
+      }
+      ++(iStats->calls);
+      iStats->seconds += seconds;
+      iStats->processMaxRSSgrowth += processMaxRSSgrowth;
+    } // Record()
+
+  }; // class AnalysisTreeProfiler
+
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+  namespace rntuple = ROOT;
+#else
+  namespace rntuple = ROOT::Experimental;
+#endif
+
+  /**
+   * @brief Writes a copy of the content of a tree into a RNTuple
+   *
+   * The RNTuple model is built from the leaves the tree has at construction:
+   * each scalar leaf becomes a field with the same name and type, and each
+   * array leaf (fixed or variable size, multidimensional arrays flattened)
+   * becomes a std::vector field. Fill() copies the current content of the
+   * leaves, so it must follow the TTree::Fill() of the same entry.
+   * Leaves added to the tree later are not written.
+   */
+  class TreeRNTupleMirror {
+  public:
+
+    TreeRNTupleMirror(TTree& tree, std::string const& name, TFile& file,
+                      rntuple::RNTupleWriteOptions const& options)
+      : fTree(tree)
+    {
+      auto model = rntuple::RNTupleModel::Create();
+      for (TObject* obj: *(fTree.GetListOfLeaves()))
+        AddLeaf(*model, *static_cast<TLeaf*>(obj));
+      fWriter = rntuple::RNTupleWriter::Append(std::move(model), name, file, options);
+    }
+
+    /// Copies the current content of the mirrored leaves into a new entry
+    void Fill()
+    {
+      for (auto const& copyLeaf: fCopiers) copyLeaf();
+      fWriter->Fill();
+    }
+
+    /// Returns whether leaves (not mirrored) were added since the last check
+    bool NewLeaves()
+    {
+      int const nLeaves = fTree.GetListOfLeaves()->GetEntriesFast();
+      if (nLeaves == fNLeaves) return false;
+      fNLeaves = nLeaves;
+      return true;
+    }
+
+  private:
+    TTree& fTree;
+    int fNLeaves = 0; ///< number of leaves in the tree at the last check
+    std::vector<std::function<void()>> fCopiers; ///< one per mirrored leaf
+    std::unique_ptr<rntuple::RNTupleWriter> fWriter;
+
+    void AddLeaf(rntuple::RNTupleModel& model, TLeaf& leaf)
+    {
+      ++fNLeaves;
+      std::string const type = leaf.GetTypeName();
+      if      (type == "Char_t")    AddLeaf<Char_t>   (model, leaf);
+      else if (type == "UChar_t")   AddLeaf<UChar_t>  (model, leaf);
+      else if (type == "Short_t")   AddLeaf<Short_t>  (model, leaf);
+      else if (type == "UShort_t")  AddLeaf<UShort_t> (model, leaf);
+      else if (type == "Int_t")     AddLeaf<Int_t>    (model, leaf);
+      else if (type == "UInt_t")    AddLeaf<UInt_t>   (model, leaf);
+      else if (type == "Long64_t")  AddLeaf<std::int64_t> (model, leaf);
+      else if (type == "ULong64_t") AddLeaf<std::uint64_t>(model, leaf);
+      else if (type == "Float_t")   AddLeaf<Float_t>  (model, leaf);
+      else if (type == "Double_t")  AddLeaf<Double_t> (model, leaf);
+      else if (type == "Bool_t")    AddLeaf<Bool_t>   (model, leaf);
+      else {
+        mf::LogWarning("AnalysisTree")
+          << "Leaf '" << leaf.GetName() << "' of type '" << type
+          << "' is not supported in RNTuple output and will be skipped";
+      }
+    } // AddLeaf()
+
+    template <typename T>
+    void AddLeaf(rntuple::RNTupleModel& model, TLeaf& leaf)
+    {
+      TLeaf* pLeaf = &leaf;
+      if (!leaf.GetLeafCount() && (leaf.GetLenStatic() == 1)) {
+        auto value = model.MakeField<T>(leaf.GetName());
+        fCopiers.push_back([pLeaf, value]()
+          { *value = *static_cast<T const*>(pLeaf->GetValuePointer()); });
+      }
+      else {
+        auto values = model.MakeField<std::vector<T>>(leaf.GetName());
+        fCopiers.push_back([pLeaf, values]()
+          {
+            T const* begin = static_cast<T const*>(pLeaf->GetValuePointer());
+            values->assign(begin, begin + pLeaf->GetLen());
+          });
+      }
+    } // AddLeaf<T>()
+
+  }; // class TreeRNTupleMirror
+
+
   /**
    * @brief Creates a simple ROOT tree with tracking and calorimetry information
    *
@@ -1273,6 +1476,18 @@ namespace dune {
    *   and freed; use "true" for speed, "false" to save memory
    * - <b>SaveAuxDetInfo</b> (default: false): if enabled, auxiliary detector
    *   data will be extracted and included in the tree
+   * - <b>RNTupleFileName</b> (default: empty): if specified, the content of
+   *   the trees is also written as RNTuple objects with the same names in a
+   *   file with this name; <b>RNTuplePageSize</b> (bytes, default: 0 for ROOT
+   *   default), <b>RNTupleCompression</b> (default: 505, i.e. zstd level 5) and
+   *   <b>RNTupleParallelCompression</b> (default: false) configure it; the
+   *   latter enables ROOT implicit multithreading for the whole process, with
+   *   as many threads as the art job
+   * - <b>ProfileBlocks</b> (default: false): if enabled, the time spent in each
+   *   block of analyze() (hits, tracks, showers, GEANT...) and the growth of
+   *   the peak memory of the whole process (meaningful only with one schedule)
+   *   is accumulated, printed at the end of the job and saved in a
+   *   "profiletree" tree
    */
   class AnalysisTree : public art::EDAnalyzer {
 
@@ -1284,6 +1499,7 @@ namespace dune {
     /// read access to event
     void analyze(const art::Event& evt);
     //  void beginJob() {}
+    void endJob();
     void beginSubRun(const art::SubRun& sr);
     void endSubRun(const art::SubRun& sr);
 
@@ -1385,6 +1601,17 @@ namespace dune {
 
     double ActiveBounds[6]; // Cryostat boundaries ( neg x, pos x, neg y, pos y, neg z, pos z )
 
+    AnalysisTreeProfiler fProfiler; ///< per-block timing of analyze()
+
+    std::string fRNTupleFileName; ///< RNTuple copy of the trees (empty: none)
+    rntuple::RNTupleWriteOptions fRNTupleOptions;
+    std::unique_ptr<TFile> fRNTupleFile;
+    std::unique_ptr<TreeRNTupleMirror> fTreeRNTuple; ///< created on first fill
+    std::unique_ptr<TreeRNTupleMirror> fPOTRNTuple; ///< created on first fill
+
+    /// Writes the current entry of tree into its RNTuple mirror, if enabled
+    void FillRNTuple(std::unique_ptr<TreeRNTupleMirror>& mirror, TTree& tree);
+
     /// Returns the number of trackers configured
     size_t GetNTrackers() const { return fTrackModuleLabel.size(); }
 
@@ -2347,33 +2574,33 @@ void dune::AnalysisTreeDataStruct::ClearLocalData() {
   no_hits = 0;
   no_hits_stored = 0;
 
-  std::fill(hit_tpc, hit_tpc + sizeof(hit_tpc)/sizeof(hit_tpc[0]), -9999);
-  std::fill(hit_plane, hit_plane + sizeof(hit_plane)/sizeof(hit_plane[0]), -9999);
-  std::fill(hit_wire, hit_wire + sizeof(hit_wire)/sizeof(hit_wire[0]), -9999);
-  std::fill(hit_channel, hit_channel + sizeof(hit_channel)/sizeof(hit_channel[0]), -9999);
-  std::fill(hit_peakT, hit_peakT + sizeof(hit_peakT)/sizeof(hit_peakT[0]), -99999.);
-  std::fill(hit_charge, hit_charge + sizeof(hit_charge)/sizeof(hit_charge[0]), -99999.);
-  std::fill(hit_ph, hit_ph + sizeof(hit_ph)/sizeof(hit_ph[0]), -99999.);
-  std::fill(hit_startT, hit_startT + sizeof(hit_startT)/sizeof(hit_startT[0]), -99999.);
-  std::fill(hit_endT, hit_endT + sizeof(hit_endT)/sizeof(hit_endT[0]), -99999.);
-  std::fill(hit_rms, hit_rms + sizeof(hit_rms)/sizeof(hit_rms[0]), -99999.);
-  std::fill(hit_trueX, hit_trueX + sizeof(hit_trueX)/sizeof(hit_trueX[0]), -99999.);
-  std::fill(hit_goodnessOfFit, hit_goodnessOfFit + sizeof(hit_goodnessOfFit)/sizeof(hit_goodnessOfFit[0]), -99999.);
-  std::fill(hit_multiplicity, hit_multiplicity + sizeof(hit_multiplicity)/sizeof(hit_multiplicity[0]), -99999.);
-  std::fill(hit_trkid, hit_trkid + sizeof(hit_trkid)/sizeof(hit_trkid[0]), -9999);
-  std::fill(hit_trkKey, hit_trkKey + sizeof(hit_trkKey)/sizeof(hit_trkKey[0]), -9999);
-  std::fill(hit_clusterid, hit_clusterid + sizeof(hit_clusterid)/sizeof(hit_clusterid[0]), -99999);
-  std::fill(hit_clusterKey, hit_clusterKey + sizeof(hit_clusterKey)/sizeof(hit_clusterKey[0]), -9999);
-  std::fill(hit_spacepointid, hit_spacepointid + sizeof(hit_spacepointid)/sizeof(hit_spacepointid[0]), -99999);
-  std::fill(hit_spacepointKey, hit_spacepointKey + sizeof(hit_spacepointKey)/sizeof(hit_spacepointKey[0]), -9999);
-  std::fill(hit_nelec, hit_nelec + sizeof(hit_nelec)/sizeof(hit_nelec[0]), -99999.);
-  std::fill(hit_energy, hit_energy + sizeof(hit_energy)/sizeof(hit_energy[0]), -99999.);
+  FillWith(hit_tpc, -9999);
+  FillWith(hit_plane, -9999);
+  FillWith(hit_wire, -9999);
+  FillWith(hit_channel, -9999);
+  FillWith(hit_peakT, -99999.);
+  FillWith(hit_charge, -99999.);
+  FillWith(hit_ph, -99999.);
+  FillWith(hit_startT, -99999.);
+  FillWith(hit_endT, -99999.);
+  FillWith(hit_rms, -99999.);
+  FillWith(hit_trueX, -99999.);
+  FillWith(hit_goodnessOfFit, -99999.);
+  FillWith(hit_multiplicity, -99999.);
+  FillWith(hit_trkid, -9999);
+  FillWith(hit_trkKey, -9999);
+  FillWith(hit_clusterid, -99999);
+  FillWith(hit_clusterKey, -9999);
+  FillWith(hit_spacepointid, -99999);
+  FillWith(hit_spacepointKey, -9999);
+  FillWith(hit_nelec, -99999.);
+  FillWith(hit_energy, -99999.);
   //raw digit information
-  std::fill(rawD_ph, rawD_ph + sizeof(rawD_ph)/sizeof(rawD_ph[0]), -99999.);
-  std::fill(rawD_peakT, rawD_peakT + sizeof(rawD_peakT)/sizeof(rawD_peakT[0]), -99999.);
-  std::fill(rawD_charge, rawD_charge + sizeof(rawD_charge)/sizeof(rawD_charge[0]), -99999.);
-  std::fill(rawD_fwhh, rawD_fwhh + sizeof(rawD_fwhh)/sizeof(rawD_fwhh[0]), -99999.);
-  std::fill(rawD_rms, rawD_rms + sizeof(rawD_rms)/sizeof(rawD_rms[0]), -99999.);
+  FillWith(rawD_ph, -99999.);
+  FillWith(rawD_peakT, -99999.);
+  FillWith(rawD_charge, -99999.);
+  FillWith(rawD_fwhh, -99999.);
+  FillWith(rawD_rms, -99999.);
 
   no_flashes = 0;
   std::fill(flash_time, flash_time + sizeof(flash_time)/sizeof(flash_time[0]), -9999);
@@ -2988,6 +3215,37 @@ void dune::AnalysisTreeDataStruct::ResizeSpacePointSolver(int nSpacePoints) {
   SpacePointEmScore.resize(nSpacePoints);
 } // dune::AnalysisTreeDataStruct::ResizeSpacePointSolver()
 
+void dune::AnalysisTreeDataStruct::ResizeHits(int nHits) {
+  // the capacity is kept, so that when the buffers are reused across events
+  // memory is only allocated when a larger event comes
+  hit_tpc.resize(nHits);
+  hit_plane.resize(nHits);
+  hit_wire.resize(nHits);
+  hit_channel.resize(nHits);
+  hit_peakT.resize(nHits);
+  hit_charge.resize(nHits);
+  hit_ph.resize(nHits);
+  hit_startT.resize(nHits);
+  hit_endT.resize(nHits);
+  hit_rms.resize(nHits);
+  hit_goodnessOfFit.resize(nHits);
+  hit_multiplicity.resize(nHits);
+  hit_trueX.resize(nHits);
+  hit_nelec.resize(nHits);
+  hit_energy.resize(nHits);
+  hit_trkid.resize(nHits);
+  hit_trkKey.resize(nHits);
+  hit_clusterid.resize(nHits);
+  hit_clusterKey.resize(nHits);
+  hit_spacepointid.resize(nHits);
+  hit_spacepointKey.resize(nHits);
+  rawD_ph.resize(nHits);
+  rawD_peakT.resize(nHits);
+  rawD_charge.resize(nHits);
+  rawD_fwhh.resize(nHits);
+  rawD_rms.resize(nHits);
+} // dune::AnalysisTreeDataStruct::ResizeHits()
+
 
 
 void dune::AnalysisTreeDataStruct::SetAddresses(
@@ -3659,13 +3917,36 @@ dune::AnalysisTree::AnalysisTree(fhicl::ParameterSet const& pset) :
   bIgnoreMissingShowers     (pset.get< bool >("IgnoreMissingShowers", false)),
   isCosmics(false),
   fSaveCaloCosmics          (pset.get< bool >("SaveCaloCosmics",false)),
-  fG4minE                   (pset.get< float>("G4minE",0.01))
+  fG4minE                   (pset.get< float>("G4minE",0.01)),
+  fProfiler                 (pset.get< bool >("ProfileBlocks", false)),
+  fRNTupleFileName          (pset.get< std::string >("RNTupleFileName", ""))
 {
 
   if (fSavePFParticleInfo) fPFParticleModuleLabel = pset.get<std::string>("PFParticleModuleLabel");
 
   if (fSaveAuxDetInfo == true) fSaveGeantInfo = true;
   if (fSaveRawDigitInfo == true) fSaveHitInfo = true;
+
+  if (!fRNTupleFileName.empty()) {
+    fRNTupleOptions.SetCompression(pset.get< int >("RNTupleCompression", 505));
+    if (auto const pageSize = pset.get< std::size_t >("RNTuplePageSize", 0)) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,34,0)
+      fRNTupleOptions.SetMaxUnzippedPageSize(pageSize);
+#else
+      fRNTupleOptions.SetApproxUnzippedPageSize(pageSize);
+#endif
+    }
+    // pages are compressed in parallel via ROOT implicit multithreading;
+    // this is a process-wide setting: stick to the threads art was given
+    if (pset.get< bool >("RNTupleParallelCompression", false))
+      ROOT::EnableImplicitMT(art::Globals::instance()->nthreads());
+    TDirectory::TContext context; // keep the current ROOT directory
+    fRNTupleFile.reset(TFile::Open(fRNTupleFileName.c_str(), "RECREATE"));
+    if (!fRNTupleFile || fRNTupleFile->IsZombie()) {
+      throw art::Exception(art::errors::Configuration)
+        << "AnalysisTree: can't create RNTuple output file '" << fRNTupleFileName << "'";
+    }
+  } // if RNTuple output
   mf::LogInfo("AnalysisTree") << "Configuration:"
                               << "\n  UseBuffers: " << std::boolalpha << fUseBuffer
     ;
@@ -3747,6 +4028,59 @@ dune::AnalysisTree::~AnalysisTree()
   DestroyData();
 }
 
+void dune::AnalysisTree::FillRNTuple
+  (std::unique_ptr<TreeRNTupleMirror>& mirror, TTree& tree)
+{
+  if (!fRNTupleFile) return;
+  if (!mirror) {
+    mirror = std::make_unique<TreeRNTupleMirror>
+      (tree, tree.GetName(), *fRNTupleFile, fRNTupleOptions);
+  }
+  else if (mirror->NewLeaves()) {
+    mf::LogWarning("AnalysisTree") << "Tree '" << tree.GetName()
+      << "' has branches created after its first entry, which are not in the RNTuple output";
+  }
+  mirror->Fill();
+} // dune::AnalysisTree::FillRNTuple()
+
+void dune::AnalysisTree::endJob()
+{
+  if (fRNTupleFile) {
+    // the writers commit their data on destruction, before the file is closed
+    fTreeRNTuple.reset();
+    fPOTRNTuple.reset();
+    fRNTupleFile->Close();
+  }
+
+  if (!fProfiler.Enabled()) return;
+
+  art::ServiceHandle<art::TFileService> tfs;
+  TTree* profileTree = tfs->make<TTree>("profiletree","analyze() block profile");
+  std::string name;
+  ULong64_t calls;
+  Double_t seconds;
+  Long64_t processMaxRSSgrowth;
+  profileTree->Branch("name",&name);
+  profileTree->Branch("calls",&calls,"calls/l");
+  profileTree->Branch("seconds",&seconds,"seconds/D");
+  profileTree->Branch("processMaxRSSgrowth",&processMaxRSSgrowth,"processMaxRSSgrowth/L");
+
+  mf::LogInfo log("AnalysisTreeProfile");
+  log << "Time spent in the blocks of AnalysisTree::analyze():";
+  for (AnalysisTreeProfiler::BlockStats_t const& stats: fProfiler.Stats()) {
+    log << "\n  " << std::setw(22) << std::left << stats.name << std::right
+        << std::setw(8) << stats.calls << " calls "
+        << std::setw(12) << stats.seconds << " s ("
+        << std::setw(10) << (stats.seconds / stats.calls * 1e3) << " ms/call), process peak memory +"
+        << stats.processMaxRSSgrowth << " kB";
+    name = stats.name;
+    calls = stats.calls;
+    seconds = stats.seconds;
+    processMaxRSSgrowth = stats.processMaxRSSgrowth;
+    profileTree->Fill();
+  } // for blocks
+} // dune::AnalysisTree::endJob()
+
 void dune::AnalysisTree::CreateTree(bool bClearData /* = false */) {
   if (!fTree) {
     art::ServiceHandle<art::TFileService> tfs;
@@ -3809,20 +4143,29 @@ void dune::AnalysisTree::endSubRun(const art::SubRun& sr)
   else
     SubRunData.potnumiETORTGT = 0;
 
-  if (fPOT) fPOT->Fill();
+  if (fPOT) {
+    fPOT->Fill();
+    FillRNTuple(fPOTRNTuple, *fPOT);
+  }
 
 }
 
 void dune::AnalysisTree::analyze(const art::Event& evt)
 {
   std::cout << "Analysing.\n\n";
-  //services
-  art::ServiceHandle<cheat::BackTrackerService> bt_serv;
-  art::ServiceHandle<cheat::ParticleInventoryService> pi_serv;
+  auto setupProfile = fProfiler.Measure("setup");
 
   // collect the sizes which might me needed to resize the tree data structure:
   bool isMC = !evt.isRealData();
 
+  //services (truth information, only used with MC)
+  cheat::BackTrackerService* bt_serv = nullptr;
+  cheat::ParticleInventoryService* pi_serv = nullptr;
+  if (isMC) {
+    bt_serv = art::ServiceHandle<cheat::BackTrackerService>().get();
+    pi_serv = art::ServiceHandle<cheat::ParticleInventoryService>().get();
+  }
+
   // * hits
   std::vector<art::Ptr<recob::Hit> > hitlist;
   auto hitListHandle = evt.getHandle< std::vector<recob::Hit> >(fHitsModuleLabel);
@@ -4009,6 +4352,8 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
     fData->ResizeMCTrack(nMCTracks);
   if (fSaveSpacePointSolverInfo)
     fData->ResizeSpacePointSolver(nSpacePoints);
+  if (fSaveHitInfo) // (but at least for one of them, so that the branches have an address)
+    fData->ResizeHits(std::max((int) hitlist.size(), 1));
 
   fData->ClearLocalData(); // don't bother clearing tracker data yet
 
@@ -4146,17 +4491,32 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
   auto const detProp = art::ServiceHandle<detinfo::DetectorPropertiesService const>()->DataFor(evt, clockData);
 
+  setupProfile.Stop();
+
   //hit information
   if (fSaveHitInfo){
+    auto const profile = fProfiler.Measure("hits");
     fData->no_hits = (int) NHits;
-    fData->no_hits_stored = TMath::Min( (int) NHits, (int) kMaxHits);
-    if (NHits > kMaxHits) {
-      // got this error? consider increasing kMaxHits
-      // (or ask for a redesign using vectors)
-      mf::LogError("AnalysisTree:limits") << "event has " << NHits
-                                          << " hits, only kMaxHits=" << kMaxHits << " stored in tree";
-    }
-    for (size_t i = 0; i < NHits && i < kMaxHits ; ++i){//loop over hits
+    fData->no_hits_stored = (int) NHits;
+    // hit to RawDigit association, built once for all hits; the waveform of
+    // each channel is uncompressed the first time one of its hits needs it
+    std::optional<art::FindManyP<raw::RawDigit>> fmrd;
+    std::unordered_map<raw::ChannelID_t, std::vector<short>> rawadcs;
+    if (fSaveRawDigitInfo && hitListHandle) fmrd.emplace(hitListHandle,evt,fHitsModuleLabel);
+
+    // SimChannel of each channel, and for the channels with hits the running sums
+    // of electrons and energy over its TDCs, so a hit's truth charge is a difference
+    // of two entries found by binary search
+    struct SimChannelSums {
+      std::vector<sim::SimChannel::TDC_t> tdc;
+      std::vector<double> nelec{0.};  // nelec[k+1]: sum over tdc[0..k]
+      std::vector<double> energy{0.};
+    };
+    std::unordered_map<raw::ChannelID_t, const sim::SimChannel*> simChannelMap;
+    std::unordered_map<raw::ChannelID_t, SimChannelSums> simChannelSums;
+    for (const sim::SimChannel* sc : fSimChannels) simChannelMap[sc->Channel()] = sc;
+
+    for (size_t i = 0; i < NHits; ++i){//loop over hits
       fData->hit_channel[i] = hitlist[i]->Channel();
       fData->hit_tpc[i]   = hitlist[i]->WireID().TPC;
       fData->hit_plane[i]   = hitlist[i]->WireID().Plane;
@@ -4196,16 +4556,20 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
         }
       */
 
-      if (fSaveRawDigitInfo){
+      if (fmrd){
         //Hit to RawDigit information
-        art::FindManyP<raw::RawDigit> fmrd(hitListHandle,evt,fHitsModuleLabel);
         if (hitlist[i]->WireID().Plane==2)
           {
-            int dataSize = fmrd.at(i)[0]->Samples();
-            short ped = fmrd.at(i)[0]->GetPedestal();
-
-            std::vector<short> rawadc(dataSize);
-            raw::Uncompress(fmrd.at(i)[0]->ADCs(), rawadc, fmrd.at(i)[0]->Compression());
+            const art::Ptr<raw::RawDigit>& digit = fmrd->at(i)[0];
+            int dataSize = digit->Samples();
+            short ped = digit->GetPedestal();
+
+            auto rawadcitr = rawadcs.find(digit->Channel());
+            if (rawadcitr == rawadcs.end()){
+              rawadcitr = rawadcs.emplace(digit->Channel(), std::vector<short>(dataSize)).first;
+              raw::Uncompress(digit->ADCs(), rawadcitr->second, digit->Compression());
+            }
+            const std::vector<short>& rawadc = rawadcitr->second;
             int t0 = hitlist[i]->PeakTime() - 3*(hitlist[i]->RMS());
             if (t0<0) t0 = 0;
             int t1 = hitlist[i]->PeakTime() + 3*(hitlist[i]->RMS());
@@ -4241,17 +4605,33 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
       if (!evt.isRealData()&&!isCosmics){
         fData -> hit_nelec[i] = 0;
         fData -> hit_energy[i] = 0;
-        const sim::SimChannel* chan = 0;
-        for(size_t sc = 0; sc < fSimChannels.size(); ++sc){
-          if(fSimChannels[sc]->Channel() == hitlist[i]->Channel()) chan = fSimChannels[sc];
-        }
-        if (chan){
-    for(auto const& mapitr : chan->TDCIDEMap()){
-            // loop over the vector of IDE objects.
-      for(auto const& ide : mapitr.second){
-              fData -> hit_nelec[i] += ide.numElectrons;
-              fData -> hit_energy[i] += ide.energy;
+        auto scitr = simChannelMap.find(hitlist[i]->Channel());
+        if (scitr != simChannelMap.end()){
+          auto sumitr = simChannelSums.find(scitr->first);
+          if (sumitr == simChannelSums.end()){
+            SimChannelSums sums;
+            for(auto const& mapitr : scitr->second->TDCIDEMap()){
+              double nelec = 0., energy = 0.;
+              // loop over the vector of IDE objects.
+              for(auto const& ide : mapitr.second){
+                nelec += ide.numElectrons;
+                energy += ide.energy;
+              }
+              sums.tdc.push_back(mapitr.first);
+              sums.nelec.push_back(sums.nelec.back() + nelec);
+              sums.energy.push_back(sums.energy.back() + energy);
             }
+            sumitr = simChannelSums.emplace(scitr->first, std::move(sums)).first;
+          }
+          // only the deposits within the hit's time window
+          const SimChannelSums& sums = sumitr->second;
+          double tdc0 = clockData.TPCTick2TDC(hitlist[i]->StartTick());
+          double tdc1 = clockData.TPCTick2TDC(hitlist[i]->EndTick());
+          size_t k0 = std::lower_bound(sums.tdc.begin(), sums.tdc.end(), tdc0) - sums.tdc.begin();
+          size_t k1 = std::upper_bound(sums.tdc.begin(), sums.tdc.end(), tdc1) - sums.tdc.begin();
+          if (k1 > k0){
+            fData -> hit_nelec[i] = sums.nelec[k1] - sums.nelec[k0];
+            fData -> hit_energy[i] = sums.energy[k1] - sums.energy[k0];
           }
         }
       }
@@ -4261,7 +4641,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
     if (hitListHandle) {
       //Find tracks associated with hits
       art::FindManyP<recob::Track> fmtk(hitListHandle,evt,fTrackModuleLabel[0]);
-      for (size_t i = 0; i < NHits && i < kMaxHits ; ++i){//loop over hits
+      for (size_t i = 0; i < NHits; ++i){//loop over hits
         if (fmtk.isValid()){
           if (fmtk.at(i).size()!=0){
             fData->hit_trkid[i] = fmtk.at(i)[0]->ID();
@@ -4283,7 +4663,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
       //Find clusters and spacepoints associated with hits
       art::FindManyP<recob::Cluster> fmcl(hitListHandle,evt,fClusterModuleLabel);
       art::FindManyP<recob::SpacePoint> fmsp(hitListHandle,evt,fSpacePointSolverModuleLabel);
-      for (size_t i = 0; i < NHits && i < kMaxHits ; ++i){//loop over hits
+      for (size_t i = 0; i < NHits; ++i){//loop over hits
         if (fmcl.isValid() && fmcl.at(i).size()!=0){
           fData->hit_clusterid[i] = fmcl.at(i)[0]->ID();
           fData->hit_clusterKey[i] = fmcl.at(i)[0].key();
@@ -4299,6 +4679,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
 
   if(fSavePandoraNuVertexInfo) {
+    auto const profile = fProfiler.Measure("pandoraNuVertex");
     lar_pandora::PFParticleVector particleVector;
     lar_pandora::LArPandoraHelper::CollectPFParticles(evt, fPandoraNuVertexModuleLabel, particleVector);
     lar_pandora::VertexVector vertexVector;
@@ -4346,6 +4727,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
 
   if(fSaveNuRecoEnergyInfo){
+    auto const profile = fProfiler.Measure("nuRecoEnergy");
     auto ereconuein = evt.getHandle<dune::EnergyRecoOutput>(fEnergyRecoNueLabel);
     auto ereconumuin = evt.getHandle<dune::EnergyRecoOutput>(fEnergyRecoNumuLabel);
     auto ereconumuin_range = evt.getHandle<dune::EnergyRecoOutput>(fEnergyRecoNumuRangeLabel);
@@ -4406,6 +4788,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
 
   if(fSaveNuRecoAngleInfo){
+    auto const profile = fProfiler.Measure("nuRecoAngle");
     auto anglereconuein = evt.getHandle<dune::AngularRecoOutput>(fAngleRecoNueLabel);
     auto anglereconumuin = evt.getHandle<dune::AngularRecoOutput>(fAngleRecoNumuLabel);
     auto anglereconuepfpin = evt.getHandle<dune::AngularRecoOutput>(fAngleRecoNuePFPLabel);
@@ -4464,6 +4847,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
   } // end fSaveNuRecoEnergyInfo
 
   if (fSaveClusterInfo){
+    auto const profile = fProfiler.Measure("clusters");
     fData->nclusters = (int) NClusters;
     if (NClusters > kMaxClusters){
       // got this error? consider increasing kMaxClusters
@@ -4471,6 +4855,8 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
       mf::LogError("AnalysisTree:limits") << "event has " << NClusters
                                           << " clusters, only kMaxClusters=" << kMaxClusters << " stored in tree";
     }
+    std::optional<art::FindManyP<anab::CosmicTag>> fmcct;
+    if (NClusters > 0) fmcct.emplace(clusterListHandle,evt,fCosmicClusterTaggerAssocLabel);
     for(unsigned int ic=0; ic<NClusters;++ic){//loop over clusters
       art::Ptr<recob::Cluster> clusterholder(clusterListHandle, ic);
       const recob::Cluster& cluster = *clusterholder;
@@ -4494,20 +4880,20 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
       fData->cluster_EndTick[ic] = cluster.EndTick();
 
       //Cosmic Tagger information for cluster
-      art::FindManyP<anab::CosmicTag> fmcct(clusterListHandle,evt,fCosmicClusterTaggerAssocLabel);
-      if (fmcct.isValid()){
-        fData->cluncosmictags_tagger[ic]     = fmcct.at(ic).size();
-        if (fmcct.at(ic).size()>0){
-          if(fmcct.at(ic).size()>1)
+      if (fmcct->isValid()){
+        fData->cluncosmictags_tagger[ic]     = fmcct->at(ic).size();
+        if (fmcct->at(ic).size()>0){
+          if(fmcct->at(ic).size()>1)
             std::cerr << "\n Warning : more than one cosmic tag per cluster in module! assigning the first tag to the cluster" << fCosmicClusterTaggerAssocLabel;
-          fData->clucosmicscore_tagger[ic] = fmcct.at(ic).at(0)->CosmicScore();
-          fData->clucosmictype_tagger[ic] = fmcct.at(ic).at(0)->CosmicType();
+          fData->clucosmicscore_tagger[ic] = fmcct->at(ic).at(0)->CosmicScore();
+          fData->clucosmictype_tagger[ic] = fmcct->at(ic).at(0)->CosmicType();
         }
       }
     }//end loop over clusters
   }//end fSaveClusterInfo
 
   if (fSaveSpacePointSolverInfo){
+    auto const profile = fProfiler.Measure("spacepoints");
     fData->nspacepoints = (unsigned int) nSpacePoints;
 
     // Largely copied from Robert Sulej's ReadSpacePointAndCnn_module.cc
@@ -4557,6 +4943,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
   }//end fSpacePointSolverInfo
 
   if (fSaveFlashInfo){
+    auto const profile = fProfiler.Measure("flashes");
     fData->no_flashes = (int) NFlashes;
     if (NFlashes > kMaxFlashes) {
       // got this error? consider increasing kMaxHits
@@ -4579,6 +4966,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
   }
 
   if (fSaveExternCounterInfo){
+    auto const profile = fProfiler.Measure("externalCounters");
     fData->no_ExternCounts = (int) NExternCounts;
     if (NExternCounts > kMaxExternCounts) {
       // got this error? consider increasing kMaxHits
@@ -4598,6 +4986,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
   //Save PFParticle information
   if (fSavePFParticleInfo){
+    auto const profile = fProfiler.Measure("pfparticles");
     AnalysisTreeDataStruct::PFParticleDataStruct& PFParticleData = fData->GetPFParticleData();
     size_t NPFParticles = pfparticlelist.size();
 
@@ -4736,6 +5125,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
   } // if fSavePFParticleInfo
 
   if (fSaveShowerInfo){
+    auto const profile = fProfiler.Measure("showers");
 
     // fill data from all the shower algorithms
     for (size_t iShowerAlgo = 0; iShowerAlgo < NShowerAlgos; ++iShowerAlgo) {
@@ -4771,6 +5161,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
   //track information for multiple trackers
   if (fSaveTrackInfo) {
+    auto const profile = fProfiler.Measure("tracks");
 
     // Computing hit to MC association before enter the loop in each track
     // This is used for the compleness of tracks
@@ -4812,62 +5203,77 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
       // - Should the minimal track length be 50 cm?  The default of 100 has been used.
       trkf::TrackMomentumCalculator trkm{/*100.*/};
 
+      // associations of this tracker's tracks, looked up once rather than for every track
+      std::optional<art::FindManyP<anab::T0>> fmt0, fmmct0;
+      std::optional<art::FindManyP<anab::CosmicTag>> fmct, fmcnt, fmbfm;
+      std::optional<art::FindMany<anab::ParticleID>> fmpid;
+      std::optional<art::FindOneP<anab::MVAPIDResult>> fmvapid;
+      std::optional<art::FindMany<anab::Calorimetry>> fmcal;
+      std::optional<art::FindManyP<recob::Hit>> fmht;
+      if (NTracks > 0){
+        fmt0.emplace(trackListHandle[iTracker],evt,fFlashT0FinderLabel[iTracker]);
+        fmmct0.emplace(trackListHandle[iTracker],evt,fMCT0FinderLabel[iTracker]);
+        fmct.emplace(trackListHandle[iTracker],evt,fCosmicTaggerAssocLabel[iTracker]);
+        fmcnt.emplace(trackListHandle[iTracker],evt,fContainmentTaggerAssocLabel[iTracker]);
+        fmbfm.emplace(trackListHandle[iTracker],evt,fFlashMatchAssocLabel[iTracker]);
+        fmpid.emplace(trackListHandle[iTracker], evt, fParticleIDModuleLabel[iTracker]);
+        if(fMVAPIDTrackModuleLabel[iTracker].size())
+          fmvapid.emplace(trackListHandle[iTracker], evt, fMVAPIDTrackModuleLabel[iTracker]);
+        fmcal.emplace(trackListHandle[iTracker], evt, fCalorimetryModuleLabel[iTracker]);
+        if (isMC) fmht.emplace(trackListHandle[iTracker], evt, fTrackModuleLabel[iTracker]);
+      }
+
       for(size_t iTrk=0; iTrk < NTracks; ++iTrk){//loop over tracks
 
         //save t0 from reconstructed flash track matching for every track
-        art::FindManyP<anab::T0> fmt0(trackListHandle[iTracker],evt,fFlashT0FinderLabel[iTracker]);
-        if (fmt0.isValid()){
-          if(fmt0.at(iTrk).size()>0){
-            if(fmt0.at(iTrk).size()>1)
+        if (fmt0->isValid()){
+          if(fmt0->at(iTrk).size()>0){
+            if(fmt0->at(iTrk).size()>1)
               std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fFlashT0FinderLabel[iTracker];
-            TrackerData.trkflashT0[iTrk] = fmt0.at(iTrk).at(0)->Time();
+            TrackerData.trkflashT0[iTrk] = fmt0->at(iTrk).at(0)->Time();
           }
         }
 
         //save t0 from reconstructed flash track matching for every track
-        art::FindManyP<anab::T0> fmmct0(trackListHandle[iTracker],evt,fMCT0FinderLabel[iTracker]);
-        if (fmmct0.isValid()){
-          if(fmmct0.at(iTrk).size()>0){
-            if(fmmct0.at(iTrk).size()>1)
+        if (fmmct0->isValid()){
+          if(fmmct0->at(iTrk).size()>0){
+            if(fmmct0->at(iTrk).size()>1)
               std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the cluster" << fMCT0FinderLabel[iTracker];
-            TrackerData.trktrueT0[iTrk] = fmmct0.at(iTrk).at(0)->Time();
+            TrackerData.trktrueT0[iTrk] = fmmct0->at(iTrk).at(0)->Time();
           }
         }
 
         //Cosmic Tagger information
-        art::FindManyP<anab::CosmicTag> fmct(trackListHandle[iTracker],evt,fCosmicTaggerAssocLabel[iTracker]);
-        if (fmct.isValid()){
-          TrackerData.trkncosmictags_tagger[iTrk]     = fmct.at(iTrk).size();
-          if (fmct.at(iTrk).size()>0){
-            if(fmct.at(iTrk).size()>1)
+        if (fmct->isValid()){
+          TrackerData.trkncosmictags_tagger[iTrk]     = fmct->at(iTrk).size();
+          if (fmct->at(iTrk).size()>0){
+            if(fmct->at(iTrk).size()>1)
               std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fCosmicTaggerAssocLabel[iTracker];
-            TrackerData.trkcosmicscore_tagger[iTrk] = fmct.at(iTrk).at(0)->CosmicScore();
-            TrackerData.trkcosmictype_tagger[iTrk] = fmct.at(iTrk).at(0)->CosmicType();
+            TrackerData.trkcosmicscore_tagger[iTrk] = fmct->at(iTrk).at(0)->CosmicScore();
+            TrackerData.trkcosmictype_tagger[iTrk] = fmct->at(iTrk).at(0)->CosmicType();
           }
         }
 
         //Containment Tagger information
-        art::FindManyP<anab::CosmicTag> fmcnt(trackListHandle[iTracker],evt,fContainmentTaggerAssocLabel[iTracker]);
-        if (fmcnt.isValid()){
-          TrackerData.trkncosmictags_containmenttagger[iTrk]     = fmcnt.at(iTrk).size();
-          if (fmcnt.at(iTrk).size()>0){
-            if(fmcnt.at(iTrk).size()>1)
+        if (fmcnt->isValid()){
+          TrackerData.trkncosmictags_containmenttagger[iTrk]     = fmcnt->at(iTrk).size();
+          if (fmcnt->at(iTrk).size()>0){
+            if(fmcnt->at(iTrk).size()>1)
               std::cerr << "\n Warning : more than one containment tag per track in module! assigning the first tag to the track" << fContainmentTaggerAssocLabel[iTracker];
-            TrackerData.trkcosmicscore_containmenttagger[iTrk] = fmcnt.at(iTrk).at(0)->CosmicScore();
-            TrackerData.trkcosmictype_containmenttagger[iTrk] = fmcnt.at(iTrk).at(0)->CosmicType();
+            TrackerData.trkcosmicscore_containmenttagger[iTrk] = fmcnt->at(iTrk).at(0)->CosmicScore();
+            TrackerData.trkcosmictype_containmenttagger[iTrk] = fmcnt->at(iTrk).at(0)->CosmicType();
           }
         }
 
         //Flash match compatibility information
         //Unlike CosmicTagger, Flash match doesn't assign a cosmic tag for every track. For those tracks, AnalysisTree initializes them with -9999 or -99999
-        art::FindManyP<anab::CosmicTag> fmbfm(trackListHandle[iTracker],evt,fFlashMatchAssocLabel[iTracker]);
-        if (fmbfm.isValid()){
-          TrackerData.trkncosmictags_flashmatch[iTrk] = fmbfm.at(iTrk).size();
-          if (fmbfm.at(iTrk).size()>0){
-            if(fmbfm.at(iTrk).size()>1)
+        if (fmbfm->isValid()){
+          TrackerData.trkncosmictags_flashmatch[iTrk] = fmbfm->at(iTrk).size();
+          if (fmbfm->at(iTrk).size()>0){
+            if(fmbfm->at(iTrk).size()>1)
               std::cerr << "\n Warning : more than one cosmic tag per track in module! assigning the first tag to the track" << fFlashMatchAssocLabel[iTracker];
-            TrackerData.trkcosmicscore_flashmatch[iTrk] = fmbfm.at(iTrk).at(0)->CosmicScore();
-            TrackerData.trkcosmictype_flashmatch[iTrk] = fmbfm.at(iTrk).at(0)->CosmicType();
+            TrackerData.trkcosmicscore_flashmatch[iTrk] = fmbfm->at(iTrk).at(0)->CosmicScore();
+            TrackerData.trkcosmictype_flashmatch[iTrk] = fmbfm->at(iTrk).at(0)->CosmicType();
             //std::cout<<"\n"<<evt.event()<<"\t"<<iTrk<<"\t"<<fmbfm.at(iTrk).at(0)->CosmicScore()<<"\t"<<fmbfm.at(iTrk).at(0)->CosmicType();
           }
         }
@@ -4987,9 +5393,8 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
         // find particle ID info
         // This was updated to gather the Chi2 information for each particle with the new definitions of anab::ParticleID class. It was previously commented by Jake Calcutt
-        art::FindMany<anab::ParticleID> fmpid(trackListHandle[iTracker], evt, fParticleIDModuleLabel[iTracker]);
-        if(fmpid.isValid()) {
-          std::vector<const anab::ParticleID*> pids = fmpid.at(iTrk);
+        if(fmpid->isValid()) {
+          const std::vector<const anab::ParticleID*>& pids = fmpid->at(iTrk);
 
           for (size_t ipid = 0; ipid < pids.size(); ++ipid){
             if (!pids[ipid]->PlaneID().isValid) continue;
@@ -5023,10 +5428,9 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
           }
         } // fmpid.isValid()
 
-        if(fMVAPIDTrackModuleLabel[iTracker].size()){
-          art::FindOneP<anab::MVAPIDResult> fmvapid(trackListHandle[iTracker], evt, fMVAPIDTrackModuleLabel[iTracker]);
-          if(fmvapid.isValid()) {
-            const art::Ptr<anab::MVAPIDResult> pid = fmvapid.at(iTrk);
+        if(fmvapid){
+          if(fmvapid->isValid()) {
+            const art::Ptr<anab::MVAPIDResult> pid = fmvapid->at(iTrk);
             TrackerData.trkpidmvamu[iTrk] = pid->mvaOutput.at("muon");
             TrackerData.trkpidmvae[iTrk] = pid->mvaOutput.at("electron");
             TrackerData.trkpidmvapich[iTrk] = pid->mvaOutput.at("pich");
@@ -5034,9 +5438,8 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
             TrackerData.trkpidmvapr[iTrk] = pid->mvaOutput.at("proton");
           } // fmvapid.isValid()
         }
-        art::FindMany<anab::Calorimetry> fmcal(trackListHandle[iTracker], evt, fCalorimetryModuleLabel[iTracker]);
-        if (fmcal.isValid()){
-          std::vector<const anab::Calorimetry*> calos = fmcal.at(iTrk);
+        if (fmcal->isValid()){
+          const std::vector<const anab::Calorimetry*>& calos = fmcal->at(iTrk);
           if (calos.size() > TrackerData.GetMaxPlanesPerTrack(iTrk)) {
             // if you get this message, there is probably a bug somewhere since
             // the calorimetry planes should be 3.
@@ -5092,8 +5495,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
         //track truth information
         if (isMC){
           //get the hits on each plane
-          art::FindManyP<recob::Hit>      fmht(trackListHandle[iTracker], evt, fTrackModuleLabel[iTracker]);
-          std::vector< art::Ptr<recob::Hit> > allHits = fmht.at(iTrk);
+          const std::vector< art::Ptr<recob::Hit> >& allHits = fmht->at(iTrk);
           std::vector< art::Ptr<recob::Hit> > hits[kNplanes];
 
           for(size_t ah = 0; ah < allHits.size(); ++ah){
@@ -5110,7 +5512,6 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
               const art::Ptr<simb::MCTruth> mc = pi_serv->TrackIdToMCTruth_P(TrackerData.trkidtruth[iTrk][ipl]);
               TrackerData.trkorigin[iTrk][ipl] = mc->Origin();
               const simb::MCParticle *particle = pi_serv->TrackIdToParticle_P(TrackerData.trkidtruth[iTrk][ipl]);
-              const std::vector<const sim::IDE*> vide=bt_serv->TrackIdToSimIDEs_Ps(TrackerData.trkidtruth[iTrk][ipl]);
               TrackerData.trkpdgtruth[iTrk][ipl] = particle->PdgCode();
             }
           }
@@ -5133,6 +5534,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
   //Save Vertex information for multiple algorithms
   if (fSaveVertexInfo){
+    auto const profile = fProfiler.Measure("vertices");
     for (unsigned int iVertexAlg=0; iVertexAlg < NVertexAlgos; ++iVertexAlg){
       AnalysisTreeDataStruct::VertexDataStruct& VertexData = fData->GetVertexData(iVertexAlg);
 
@@ -5192,6 +5594,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
   //mc truth information
   if (isMC){
+    auto const profile = fProfiler.Measure("truth");
 
     // Find the simb::MCFlux objects corresponding to
     // each simb::MCTruth object made by the generator with
@@ -5200,6 +5603,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
                                            evt, fGenieGenModuleLabel);
 
     if (fSaveCryInfo){
+      auto const subprofile = fProfiler.Measure("truth/cry");
       //store cry (cosmic generator information)
       fData->mcevts_truthcry = mclistcry.size();
       fData->cry_no_primaries = nCryPrimaries;
@@ -5226,6 +5630,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
     // Save the protoDUNE beam generator information
     if(fSaveProtoInfo){
+      auto const subprofile = fProfiler.Measure("truth/proto");
       fData->proto_no_primaries = nProtoPrimaries;
       for(Int_t iPartp = 0; iPartp < nProtoPrimaries; ++iPartp){
         const simb::MCParticle& partp(mctruthproto->GetParticle(iPartp));
@@ -5249,6 +5654,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
     fData->mcevts_truth = mclist.size();
     if (fData->mcevts_truth > 0){//at least one mc record
       if (fSaveGenieInfo){
+        auto const subprofile = fProfiler.Measure("truth/genie");
         int neutrino_i = 0;
         for(unsigned int iList = 0; (iList < mclist.size()) && (neutrino_i < kMaxTruth) ; ++iList){
           if (mclist[iList]->NeutrinoSet()){
@@ -5365,6 +5771,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
       //Extract MC Shower information and fill the Shower branches
       if (fSaveMCShowerInfo){
+        auto const subprofile = fProfiler.Measure("truth/mcshowers");
         fData->no_mcshowers = nMCShowers;
         size_t shwr = 0;
         for(std::vector<sim::MCShower>::const_iterator imcshwr = mcshowerh->begin();
@@ -5423,6 +5830,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
       //Extract MC Track information and fill the Shower branches
       if (fSaveMCTrackInfo){
+        auto const subprofile = fProfiler.Measure("truth/mctracks");
         fData->no_mctracks = nMCTracks;
         size_t trk = 0;
         for(std::vector<sim::MCTrack>::const_iterator imctrk = mctrackh->begin();imctrk != mctrackh->end(); ++imctrk) {
@@ -5483,6 +5891,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
       //GEANT particles information
       if (fSaveGeantInfo){
+        auto const subprofile = fProfiler.Measure("truth/geant");
 
         const sim::ParticleList& plist = pi_serv->ParticleList();
 
@@ -5717,6 +6126,7 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
 
       // Now we have the GEANT info, see if we can match the protoDUNE generator particles
       if(fSaveProtoInfo){
+        auto const subprofile = fProfiler.Measure("truth/protoMatch");
         for(Int_t prt = 0; prt < nProtoPrimaries; ++prt){
           for(Int_t gnt = 0; gnt < fData->geant_list_size; ++gnt){
 //            if(fData->proto_pdg[prt] == fData->pdg[gnt] && fData->proto_px[prt] == fData->Px[gnt]){
@@ -5732,7 +6142,11 @@ void dune::AnalysisTree::analyze(const art::Event& evt)
     }//if (mcevts_truth)
   }//if (isMC){
   fData->taulife = detProp.ElectronLifetime();
-  fTree->Fill();
+  {
+    auto const profile = fProfiler.Measure("fill");
+    fTree->Fill();
+    FillRNTuple(fTreeRNTuple, *fTree);
+  }
 
   if (mf::isDebugEnabled()) {
     // use mf::LogDebug instead of MF_LOG_DEBUG because we reuse it in many lines;
@@ -19,6 +19,7 @@
 #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Principal/Event.h"
 #include "art/Framework/Principal/SubRun.h"
+#include "art/Utilities/Globals.h"
 #include "fhiclcpp/ParameterSet.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "art_root_io/TFileService.h"
@@ -47,6 +48,10 @@
 // root
 #include "TFile.h"
 #include "TTree.h"
+#include "TROOT.h"
+#include "RVersion.h"
+#include "ROOT/RNTupleModel.hxx"
+#include "ROOT/RNTupleWriter.hxx"
 #include "TH1D.h"
 #include "TH2D.h"
 
@@ -63,6 +68,12 @@
 
 namespace caf {
 
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+  namespace rntuple = ROOT;
+#else
+  namespace rntuple = ROOT::Experimental;
+#endif
+
   class CAFMaker : public art::EDAnalyzer {
 
     public:
@@ -114,6 +125,11 @@ namespace caf {
       TTree* fFlatTree; //Ownership will be managed directly by ROOT
       std::unique_ptr<flat::Flat<caf::StandardRecord>> fFlatRecord;
 
+      std::unique_ptr<TFile> fRNTupleFile;
+      rntuple::RNTupleWriteOptions fRNTupleOptions;
+      std::unique_ptr<rntuple::RNTupleWriter> fRNTupleWriter;
+      std::shared_ptr<caf::StandardRecord> fRNTupleRecord;
+
       genie::NtpMCEventRecord *fEventRecord = nullptr;
 
       double fMetaPOT;
@@ -158,6 +174,24 @@ namespace caf {
       fFlatFile = std::make_unique<TFile>("flatcaf.root", "RECREATE", "",
                             ROOT::CompressionSettings(ROOT::kLZ4, 1));
     }
+
+    if(pset.get<bool>("CreateRNTupleCAF", false)){
+      // Same StandardRecord as cafTree, stored as RNTuple. The default
+      // compression (505, zstd level 5) is the RNTuple one.
+      fRNTupleOptions.SetCompression(pset.get<int>("RNTupleCompression", 505));
+      if(auto const pageSize = pset.get<std::size_t>("RNTuplePageSize", 0)){
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,34,0)
+        fRNTupleOptions.SetMaxUnzippedPageSize(pageSize);
+#else
+        fRNTupleOptions.SetApproxUnzippedPageSize(pageSize);
+#endif
+      }
+      // pages are compressed in parallel via ROOT implicit multithreading;
+      // this is a process-wide setting: stick to the threads art was given
+      if(pset.get<bool>("RNTupleParallelCompression", false))
+        ROOT::EnableImplicitMT(art::Globals::instance()->nthreads());
+      fRNTupleFile = std::make_unique<TFile>("rntuplecaf.root", "RECREATE");
+    }
   }
 
   //------------------------------------------------------------------------------
@@ -196,6 +230,12 @@ namespace caf {
       fFlatRecord = std::make_unique<flat::Flat<caf::StandardRecord>>(fFlatTree, "rec", "", nullptr);
     }
 
+    if(fRNTupleFile){
+      auto model = rntuple::RNTupleModel::Create();
+      fRNTupleRecord = model->MakeField<caf::StandardRecord>("rec");
+      fRNTupleWriter = rntuple::RNTupleWriter::Append(std::move(model), "cafTree", *fRNTupleFile, fRNTupleOptions);
+    }
+
   }
 
 
@@ -658,6 +698,12 @@ namespace caf {
       fFlatRecord->Fill(sr);
       fFlatTree->Fill();
     }
+
+    if(fRNTupleWriter){
+      // sr is not needed anymore: move it rather than copying
+      *fRNTupleRecord = std::move(sr);
+      fRNTupleWriter->Fill();
+    }
   }
 
   //------------------------------------------------------------------------------
@@ -678,6 +724,26 @@ namespace caf {
       fFlatFile->Close();
     }
 
+    if(fRNTupleFile){
+      fRNTupleWriter.reset(); // commits the remaining data
+
+      // The GENIE records are not written: RNTuple does not support their
+      // TClonesArray content
+      auto model = rntuple::RNTupleModel::Create();
+      auto pot = model->MakeField<double>("pot");
+      auto run = model->MakeField<int>("run");
+      auto subrun = model->MakeField<int>("subrun");
+      auto version = model->MakeField<int>("version");
+      auto metaWriter = rntuple::RNTupleWriter::Append(std::move(model), "meta", *fRNTupleFile, fRNTupleOptions);
+      *pot = fMetaPOT;
+      *run = fMetaRun;
+      *subrun = fMetaSubRun;
+      *version = fMetaVersion;
+      metaWriter->Fill();
+      metaWriter.reset();
+      fRNTupleFile->Close();
+    }
+
     delete fEventRecord; //Making this a unique_pointer requires too many circonvolutions because of TTree->Branch requiring a pointer to a pointer
 
   }
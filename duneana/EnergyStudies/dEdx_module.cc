@@ -61,8 +61,9 @@ namespace AnalysisExample
     void reconfigure(fhicl::ParameterSet const& pset);
     void analyze(const art::Event& evt); 
     void endJob();
-    void findDepositionVertex(std::vector<sim::SimChannel> SCHandle);
-    void checkDepositionVertex(std::vector<sim::SimChannel> SCHandle, double x, double y, double z);
+    void collectDepositions(std::vector<sim::SimChannel> const& SCHandle);
+    void findDepositionVertex();
+    void checkDepositionVertex(double x, double y, double z);
 
   private:
 
@@ -85,6 +86,12 @@ namespace AnalysisExample
     TH3D* fTrackEdepHist;
     TH3D* fShowerEdepHist;
 
+    // collection plane energy depositions of the event, collected in a single
+    // pass over the sim channels: all of them, and the positive ones sorted by z
+    struct EDep_t { float x, y, z, energy; };
+    std::vector<EDep_t> fEDeps;
+    std::vector<EDep_t> fPosEDepsByZ;
+
     // list of event numbers corresponding to unusually low dEdx measurement
     std::vector<unsigned int> fNullList;
 
@@ -174,11 +181,13 @@ namespace AnalysisExample
     unsigned int nTries = 0;
     ziFalse = -500.;
 
+    this->collectDepositions( (*simChanHandle) );
+
     // find conversion point
     while(!goodDepVertex && nTries < 300)
     {
-      this->findDepositionVertex( (*simChanHandle) );
-      this->checkDepositionVertex( (*simChanHandle), xi, yi, zi );
+      this->findDepositionVertex();
+      this->checkDepositionVertex( xi, yi, zi );
       nTries++;
     }
 
@@ -188,27 +197,16 @@ namespace AnalysisExample
     if(nTries < 300 && goodDepVertex)
     {
       fStartEdepHist->Fill(xi,yi,zi);
-      for(auto const& channel : (*simChanHandle))
+      for(auto const& eDep : fEDeps)
       {
-	if(fGeom->SignalType(channel.Channel()) == geo::kCollection)
+	fShowerEdepHist->Fill(eDep.x,eDep.y,eDep.z);
+	trackLength = std::sqrt( (eDep.x-xi)*(eDep.x-xi) + (eDep.y-yi)*(eDep.y-yi) + (eDep.z-zi)*(eDep.z-zi) );
+	if(trackLength < 2.5 /* && eDep.z >= zi*/)
 	{
-	  auto const& timeSlices = channel.TDCIDEMap();
-	  for(auto const& t : timeSlices)
-	  {
-	    auto const& eDeps = t.second;
-	    for(auto const& eDep : eDeps)
-	    {
-	      fShowerEdepHist->Fill(eDep.x,eDep.y,eDep.z);
-	      trackLength = std::sqrt( (eDep.x-xi)*(eDep.x-xi) + (eDep.y-yi)*(eDep.y-yi) + (eDep.z-zi)*(eDep.z-zi) );
-	      if(trackLength < 2.5 /* && eDep.z >= zi*/)
-	      {
-		dE += eDep.energy;
-		fTrackEdepHist->Fill(eDep.x,eDep.y,eDep.z);
-     	      }
-	    } // every energy deposition
-	  } // in every time slice
-	} // for the collection plane
-      } // and for every wire
+	  dE += eDep.energy;
+	  fTrackEdepHist->Fill(eDep.x,eDep.y,eDep.z);
+	}
+      } // every collection plane energy deposition
       dE /= 2.5;
       fMCdEdxVec.push_back(dE);
       if(dE > fMaxMCdEdx) fMaxMCdEdx = dE;
@@ -246,10 +244,10 @@ namespace AnalysisExample
 
   }
 
-  void dEdx::findDepositionVertex(std::vector<sim::SimChannel> SCHandle)
+  void dEdx::collectDepositions(std::vector<sim::SimChannel> const& SCHandle)
   {
-    zi = 1000.;
-    std::cout << "Finding Deposition Vertex... " << std::endl;
+    fEDeps.clear();
+    fPosEDepsByZ.clear();
     for(auto const& channel : SCHandle)
     {
       if(fGeom->SignalType(channel.Channel()) == geo::kCollection)
@@ -260,42 +258,50 @@ namespace AnalysisExample
 	  auto const& eDeps = t.second;
 	  for(auto const& eDep : eDeps)
 	  {
-	    if( (eDep.z < zi) && (eDep.energy > 0.) && (eDep.z > ziFalse) )
-            {
-	      xi = eDep.x;
-	      yi = eDep.y;
-	      zi = eDep.z;
-	    } // if z position is a "valid" minimum
+	    fEDeps.push_back({ eDep.x, eDep.y, eDep.z, eDep.energy });
+	    if(eDep.energy > 0.) fPosEDepsByZ.push_back(fEDeps.back());
 	  } // energy deposition loop
-	} // time slice loop 
+	} // time slice loop
       } // if collection wire
     } // sim channel loop
+    // stable, so that among equal z the first deposition in channel order comes first
+    std::stable_sort(fPosEDepsByZ.begin(), fPosEDepsByZ.end(),
+      [](EDep_t const& a, EDep_t const& b){ return a.z < b.z; });
+  } // collectDepositions
+
+  void dEdx::findDepositionVertex()
+  {
+    zi = 1000.;
+    std::cout << "Finding Deposition Vertex... " << std::endl;
+    // the lowest z position above ziFalse is a "valid" minimum
+    auto const first = std::upper_bound(fPosEDepsByZ.begin(), fPosEDepsByZ.end(), ziFalse,
+      [](double z, EDep_t const& eDep){ return z < eDep.z; });
+    if( (first != fPosEDepsByZ.end()) && (first->z < zi) )
+    {
+      xi = first->x;
+      yi = first->y;
+      zi = first->z;
+    }
   } // findDepositionVertex
 
-  void dEdx::checkDepositionVertex(std::vector<sim::SimChannel> SCHandle, double x,double y, double z)
+  void dEdx::checkDepositionVertex(double x,double y, double z)
   {
     std::cout << "Checking for Deposition Vertex" << std::endl;
     nearDeps = 0;
     double track = 0;
-    for(auto const& channel : SCHandle)
+    // only depositions within 2.5 cm in z can be within 2.5 cm
+    auto const begin = std::lower_bound(fPosEDepsByZ.begin(), fPosEDepsByZ.end(), z - 2.5,
+      [](EDep_t const& eDep, double bound){ return eDep.z < bound; });
+    auto const end = std::upper_bound(begin, fPosEDepsByZ.end(), z + 2.5,
+      [](double bound, EDep_t const& eDep){ return bound < eDep.z; });
+    for(auto eDep = begin; eDep != end; ++eDep)
     {
-      if(fGeom->SignalType(channel.Channel()) == geo::kCollection)
+      track = std::sqrt( (eDep->x-x)*(eDep->x-x) + (eDep->y-y)*(eDep->y-y) + (eDep->z-z)*(eDep->z-z) );
+      if(track < 2.5)
       {
-	auto const& timeSlices = channel.TDCIDEMap();
-	for(auto const& t : timeSlices)
-	{
-	  auto const& eDeps = t.second;
-	  for(auto const& eDep : eDeps)
-	  {
-	    track = std::sqrt( (eDep.x-x)*(eDep.x-x) + (eDep.y-y)*(eDep.y-y) + (eDep.z-z)*(eDep.z-z) );
-	    if(track < 2.5 && eDep.energy > 0.)
-	    {
-	      nearDeps++;
-	    } // if z position is minimum
-	  } // energy deposition loop
-	} // time slice loop 
-      } // if collection wire
-    } // sim channel loop
+	nearDeps++;
+      } // if z position is minimum
+    } // energy deposition loop
     if( nearDeps > 30) goodDepVertex = true;
     else ziFalse = z + 0.05;
   } // checkDepositionVertex
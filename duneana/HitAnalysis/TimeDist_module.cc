@@ -36,6 +36,7 @@
 // C++ Includes
 #include <vector>
 #include <string>
+#include <algorithm>
 
 namespace TimeDist {
 
@@ -51,6 +52,22 @@ namespace TimeDist {
 
   private:
 
+    /// Hit-flash time differences beyond the histogram range, per histogram
+    struct OutOfRange_t {
+      double under = 0.; ///< differences below the range
+      double over = 0.;  ///< differences above the range
+    };
+
+    /// Fills hist with hittime minus each of the (sorted) flashTimes; only the
+    /// flashes giving differences around the histogram range are visited,
+    /// the others are just counted in outside
+    void FillTimeDifferences(TH1D* hist, double hittime,
+                             std::vector<double> const& flashTimes,
+                             OutOfRange_t& outside) const;
+
+    /// Adds the counts in outside to the underflow and overflow of hist
+    void AddOutOfRange(TH1D* hist, OutOfRange_t const& outside) const;
+
     std::string fHitProducerLabel;        ///< The name of the producer that created hits
     std::string fFlashProducerLabel;      ///< The name of the producer that created flashes
     TH1D* fTimeHist;     ///< Hit time of all particles
@@ -117,38 +134,64 @@ namespace TimeDist {
 	fFlashHist->Fill(opflash.Time());
       } // for each Flash
 
+    // Flash times, sorted so that only the ones close to each hit are visited
+    std::vector<double> flashTimes;
+    flashTimes.reserve(flashHandle->size());
+    for ( auto const& opflash : (*flashHandle) ) flashTimes.push_back(opflash.Time());
+    std::sort(flashTimes.begin(), flashTimes.end());
+
+    OutOfRange_t outside, outsideU, outsideV, outsideW;
     for ( auto const& hit : (*hitHandle) )
       {
         double frequency = clockData.TPCClock().Frequency();
 	double hittime = hit.PeakTime()/frequency;
-	for ( auto const& opflash : (*flashHandle) )
-	  {
-	    fTmFshHist->Fill(hittime-opflash.Time());	    
-	  }
+	FillTimeDifferences(fTmFshHist, hittime, flashTimes, outside);
 	if (hit.View()==geo::kU)
-	  {
-	    for ( auto const& opflash : (*flashHandle) )
-	      {
-		fTmFshHistU->Fill(hittime-opflash.Time());	    
-	      }
-	  }
+	  FillTimeDifferences(fTmFshHistU, hittime, flashTimes, outsideU);
 	else if (hit.View()==geo::kV)
-	  {
-	    for ( auto const& opflash : (*flashHandle) )
-	      {
-		fTmFshHistV->Fill(hittime-opflash.Time());	    
-	      }
-	  }
+	  FillTimeDifferences(fTmFshHistV, hittime, flashTimes, outsideV);
 	else
-	  {
-	    for ( auto const& opflash : (*flashHandle) )
-	      {
-		fTmFshHistW->Fill(hittime-opflash.Time());	    
-	      }
-	  }
+	  FillTimeDifferences(fTmFshHistW, hittime, flashTimes, outsideW);
       } // hit for
+    AddOutOfRange(fTmFshHist,  outside);
+    AddOutOfRange(fTmFshHistU, outsideU);
+    AddOutOfRange(fTmFshHistV, outsideV);
+    AddOutOfRange(fTmFshHistW, outsideW);
   } // TimeDist::analyze()
 
+  //-----------------------------------------------------------------------
+  void TimeDist::FillTimeDifferences(TH1D* hist, double hittime,
+                                     std::vector<double> const& flashTimes,
+                                     OutOfRange_t& outside) const
+  {
+    // Flashes within the margin of the range edges are filled anyway, so that
+    // the histogram decides exactly where each difference belongs
+    double const margin = 1.;
+    double const low  = hist->GetXaxis()->GetXmin();
+    double const high = hist->GetXaxis()->GetXmax();
+    auto const begin = std::lower_bound(flashTimes.begin(), flashTimes.end(), hittime - high - margin);
+    auto const end   = std::upper_bound(begin, flashTimes.end(), hittime - low + margin);
+    for (auto flashTime = begin; flashTime != end; ++flashTime)
+      hist->Fill(hittime - *flashTime);
+    outside.over  += begin - flashTimes.begin(); // earlier flashes
+    outside.under += flashTimes.end() - end;     // later flashes
+  } // TimeDist::FillTimeDifferences()
+
+  //-----------------------------------------------------------------------
+  void TimeDist::AddOutOfRange(TH1D* hist, OutOfRange_t const& outside) const
+  {
+    // Same as filling each difference: bin content, errors and entries change,
+    // while the statistics (mean, RMS) do not include out of range values
+    int const overflowBin = hist->GetNbinsX() + 1;
+    hist->AddBinContent(0, outside.under);
+    hist->AddBinContent(overflowBin, outside.over);
+    if (hist->GetSumw2N()) {
+      hist->GetSumw2()->AddAt(hist->GetSumw2()->At(0) + outside.under, 0);
+      hist->GetSumw2()->AddAt(hist->GetSumw2()->At(overflowBin) + outside.over, overflowBin);
+    }
+    hist->SetEntries(hist->GetEntries() + outside.under + outside.over);
+  } // TimeDist::AddOutOfRange()
+
   DEFINE_ART_MODULE(TimeDist)
 
 } // namespace TimeDist
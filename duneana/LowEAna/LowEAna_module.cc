@@ -18,10 +18,11 @@
 #include <TH2F.h>
 #include <TTree.h>
 #include <TFile.h>
-#include <TGraph.h>
 #include <TRandom.h>
 #include <TVector3.h>
-#include <fcntl.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
 
 // Framework includes (not all might be necessary)
 #include "larcore/Geometry/Geometry.h"
@@ -76,6 +77,18 @@ private:
     std::vector<int> OpFlashGen;
     std::vector<double> OpFlashPur;
   };
+  // --- Define a linear interpolator of the induction (Y, Z) positions as a function of time
+  struct InterpolationEngine{
+    std::vector<int> Order;
+    std::vector<double> T, Y, Z;
+    void Build(const std::vector<double> &IndT, const std::vector<double> &IndY, const std::vector<double> &IndZ);
+    void Eval(double Time, double &RefY, double &RefZ) const;
+  };
+  // --- Define a struct to hold the backtracked truth summary of a hit
+  struct HitTruth{
+    int MainTrackID;
+    float EnergyFrac;
+  };
   // --- Some of our own functions.
   void ResetEventVariables(detinfo::DetectorClocksData clockData);
   void ResetClusterVariables();
@@ -137,10 +150,11 @@ private:
   
   bool InMyMap(
     int TrID,
-    std::map< int,
-    simb::MCParticle> ParMap);
+    const std::map< int,
+    simb::MCParticle> &ParMap);
 
   long unsigned int WhichParType  ( int TrID );
+  const HitTruth& GetHitTruth( const recob::Hit &ThisHit, detinfo::DetectorClocksData const &ClockData );
   int  GetColor      ( std::string MyString );
 
   std::vector<double> ComputeInterpolationRecoY(
@@ -161,8 +175,8 @@ private:
   std::string str( std::vector<float> MyVec );
   std::string str( std::vector<double> MyVec );
 
-  int supress_stdout();
-  void resume_stdout(int fd);
+  // --- Truth lookup that does not warn about TrackIDs missing from the particle list
+  const simb::MCParticle* TrackIdToParticle(int TrackID);
 
   double Average(std::vector<double> &v);
   double Average(std::vector<float> &v);
@@ -185,6 +199,13 @@ private:
   int /*Run,SubRun,*/Event,Flag;
   std::vector<int> TPart;
   std::vector<std::map<int,simb::MCParticle>> Parts = {};
+  // --- Per-event memo of the backtracked hit truth, keyed by (channel, start tick, end tick, local index, peak time)
+  std::map<std::tuple<raw::ChannelID_t,raw::TDCtick_t,raw::TDCtick_t,short int,float>,HitTruth> fHitTruthMemo;
+  unsigned int fHitTruthMemoHits, fHitTruthMemoMisses;
+  // --- Logging levels enabled for the current event (summary strings are only built when printed)
+  bool fLogInfo;
+  // --- Interpolation buffers reused across clusters
+  InterpolationEngine fInterpolation;
   // --- MC Interaction Variables
   std::string Interaction;
   int PDG;
@@ -364,16 +385,14 @@ void LowEAna::analyze(art::Event const & evt){
   // ---------- We want to reset all of our previous run and TTree variables -------------------// 
   // Run = evt.run();SubRun = evt.subRun();
   Event = evt.event();
+  fLogInfo = mf::isInfoEnabled();
   ResetEventVariables(clockData);
   
   //--------------------------------------------------------------------------------------------//
   //--------------------------------- Create maps for ID tracking ------------------------------//
   //--------------------------------------------------------------------------------------------//
   // -------- Fill MC Truth IDs to tracking vectors. Get a list of all of my particles ---------//
-  mf::LogInfo lparticle("particles");
   std::string lparticlestr = "";
-  const sim::ParticleList& PartList = pi_serv->ParticleList();
-  lparticle << "\nTotal #particles: " << PartList.size();
   
   // Loop over all signal+bkg handles and collect track IDs
   for ( size_t i = 0; i < fLabels.size(); i++){
@@ -383,7 +402,7 @@ void LowEAna::analyze(art::Event const & evt){
     evt.getByLabel(fLabels[i], ThisHandle);
     
     if(ThisHandle){
-      lparticlestr = PrintInColor(lparticlestr,"\n"+fLabels[i]+" *is generated!",GetColor("green"));
+      if (fLogInfo) lparticlestr = PrintInColor(lparticlestr,"\n"+fLabels[i]+" *is generated!",GetColor("green"));
       
       auto ThisValidHanlde = evt.getValidHandle<std::vector<simb::MCTruth>>(fLabels[i]); 
       art::FindManyP<simb::MCParticle> Assn(ThisValidHanlde,evt,fGEANTLabel);            
@@ -391,19 +410,18 @@ void LowEAna::analyze(art::Event const & evt){
       FillMyMaps( Parts[i], Assn, ThisValidHanlde);                                                                           
       FillMCInteractionTree(Parts[i], fInteraction, fDebug);
       TPart.push_back(Parts[i].size()); // Insert #signal+bkg particles generated
-      lparticlestr = PrintInColor(lparticlestr,"\n-> #Particles: "+str(int(Parts[i].size())),GetColor("blue"));
+      if (fLogInfo) lparticlestr = PrintInColor(lparticlestr,"\n-> #Particles: "+str(int(Parts[i].size())),GetColor("blue"));
     }
     else{
       TPart.push_back(0);
-      lparticlestr = PrintInColor(lparticlestr,"\n"+fLabels[i]+": *not generated!",GetColor("yellow"));
+      if (fLogInfo) lparticlestr = PrintInColor(lparticlestr,"\n"+fLabels[i]+": *not generated!",GetColor("yellow"));
     }
   }
-  lparticle << lparticlestr;
+  if (fLogInfo) mf::LogInfo("particles") << "\nTotal #particles: " << pi_serv->ParticleList().size() << lparticlestr;
   fMCTruthTree->Fill();
   std::cout << std::endl;//--------------------------------------------------------------------//
   //--------------------------------- Optical Flash Collection --------------------------------// 
   //-------------------------------------------------------------------------------------------//
-  mf::LogInfo lflash("flashes");
   std::string lflashstr = "";
   // Find OpHits and OpFlashes associated with the event
   art::Handle< std::vector< recob::OpHit >> OpHitHandle;
@@ -415,7 +433,6 @@ void LowEAna::analyze(art::Event const & evt){
   art::FindManyP< recob::OpHit > AssOpHits(OpFlashList, evt, fOpFlashLabel);
   
   // Grab assns with OpHits to get match to neutrino purity
-  lflash << "\nTotal number of flashes constructed: " << OpFlashList.size();
   // Loop over flashlist and assign OpHits to each flash
   for ( int i = 0; i < int(OpFlashList.size()); i++ ){
 
@@ -437,9 +454,11 @@ void LowEAna::analyze(art::Event const & evt){
       }
     }
     
-    lflash << "\nEvaluating Flash purity";
-    lflash << "\nPE of this OpFlash " << OpHitTotPE; 
-    lflash << "\nOpFlash time " << OpHitT;
+    if (fLogInfo){
+      lflashstr = lflashstr + "\nEvaluating Flash purity";
+      lflashstr = lflashstr + "\nPE of this OpFlash " + str(OpHitTotPE);
+      lflashstr = lflashstr + "\nOpFlash time " + str(OpHitT);
+    }
 
     // Get trackID from Parts
     // Calculate the flash purity, only for the Marley events
@@ -463,9 +482,7 @@ void LowEAna::analyze(art::Event const & evt){
         // Convert std::vector<int> to std::set<int> for signal_trackids
         std::set<int> SetGenTrackIDs(GenTrackIDs.begin(), GenTrackIDs.end());
         // Calculate the flash purity, for this generator's trackIDs
-        int test = supress_stdout();
         double ThisOpFlashPur = pbt->OpHitCollectionPurity(SetGenTrackIDs, MOpHits);
-        resume_stdout(test);
         OpFlashPurVector.push_back(ThisOpFlashPur);
       }
       double MaxOpFlashPur = 0; int Gen = 0; int MaxPur = 0;
@@ -478,11 +495,10 @@ void LowEAna::analyze(art::Event const & evt){
   }
   // Build a struct with all the flash vectors
   OpFlashes EventOpFlashes = {OpFlashPE,OpFlashMaxPE,OpFlashX,OpFlashY,OpFlashZ,OpFlashT,OpFlashNHit,OpFlashGen,OpFlashPur};
-  lflash << lflashstr;
+  if (fLogInfo) mf::LogInfo("flashes") << "\nTotal number of flashes constructed: " << OpFlashList.size() << lflashstr;
   std::cout << std::endl;//--------------------------------------------------------------------//
   //------------------------------- Hit collection and assignment -----------------------------// 
   //-------------------------------------------------------------------------------------------//
-  mf::LogInfo lhit("hits");
   std::string lhitstr = "";
   // --- Lift out the reco hits:
   auto reco_hits = evt.getValidHandle<std::vector<recob::Hit> >(fHitLabel);
@@ -493,35 +509,39 @@ void LowEAna::analyze(art::Event const & evt){
     
     recob::Hit const& ThisHit = reco_hits->at(hit);
     if (ThisHit.PeakTime() < 0){
-      lhitstr = PrintInColor(lhitstr,"Negative Hit Time = " + str(ThisHit.PeakTime()), GetColor("red"));
+      if (fLogInfo) lhitstr = PrintInColor(lhitstr,"Negative Hit Time = " + str(ThisHit.PeakTime()), GetColor("red"));
     }
 
     if      (ThisHit.SignalType() == 0 && ThisHit.View() == 0){Hits0.push_back( ThisHit );} // SignalType = 0
     else if (ThisHit.SignalType() == 0 && ThisHit.View() == 1){Hits1.push_back( ThisHit );} // SignalType = 0
     else if (ThisHit.SignalType() == 1)                       {Hits2.push_back( ThisHit );} // SignalType = 1
-    else    {Hits3.push_back( ThisHit ); lhit << "Hit was found with view out of scope";}
+    else    {Hits3.push_back( ThisHit ); if (fLogInfo) lhitstr = lhitstr + "\nHit was found with view out of scope";}
   } 
 
-  lhit << "\n# Hits per view: ";
-  lhit << "\nInduction Plane 0:\t" << Hits0.size();
-  lhit << "\nInduction Plane 1:\t" << Hits1.size();
-  lhit << "\nCollection Plane: \t" << Hits2.size();
-  lhit << lhitstr;
+  if (fLogInfo){
+    mf::LogInfo lhit("hits");
+    lhit << "\n# Hits per view: ";
+    lhit << "\nInduction Plane 0:\t" << Hits0.size();
+    lhit << "\nInduction Plane 1:\t" << Hits1.size();
+    lhit << "\nCollection Plane: \t" << Hits2.size();
+    lhit << lhitstr;
+  }
   std::cout << std::endl;//--------------------------------------------------------------------//
   //------------------------------------- Cluster Hit analysis --------------------------------// 
   //-------------------------------------------------------------------------------------------//
-  mf::LogInfo lcluster("clusters");
-  std::string lclusterstr = "";
   // --- Now calculate the clusters ...
   CalcAdjHits(Hits0,Clusters0,hAdjHits,hAdjHitsADCInt,clockData,false);
   CalcAdjHits(Hits1,Clusters1,hAdjHits,hAdjHitsADCInt,clockData,false);
   CalcAdjHits(Hits2,Clusters2,hAdjHits,hAdjHitsADCInt,clockData,false);
   CalcAdjHits(Hits3,Clusters3,hAdjHits,hAdjHitsADCInt,clockData,false);
 
-  lcluster << "\n# Clusters per view: ";
-  lcluster << "\nInduction Plane 0:\t" << Clusters0.size();
-  lcluster << "\nInduction Plane 1:\t" << Clusters1.size();
-  lcluster << "\nCollection Plane: \t" << Clusters2.size();
+  if (fLogInfo){
+    mf::LogInfo lcluster("clusters");
+    lcluster << "\n# Clusters per view: ";
+    lcluster << "\nInduction Plane 0:\t" << Clusters0.size();
+    lcluster << "\nInduction Plane 1:\t" << Clusters1.size();
+    lcluster << "\nCollection Plane: \t" << Clusters2.size();
+  }
   // if (Clusters3.size() != 0) PrintInColor("Other: "+str(Clusters3.size()),GetColor("red"));
   
   std::vector< std::vector< std::vector<recob::Hit>>> AllClusters; 
@@ -541,12 +561,10 @@ void LowEAna::analyze(art::Event const & evt){
       ClZ[i][j] = -1e6;
     }
   }
-  lcluster << lclusterstr;
   std::cout << std::endl;//------------- Cluster Preselection ------------------------// 
 
   ResetClusterVariables();
   for (int ii = 0; ii < int(MatchedClusters[2].size()); ii++){
-    mf::LogInfo lpreselection("preselection");
     std::string lpreselectionstr = "";
     // std::cout << "Evaluating cluster #" << ii << std::endl;    
     if (MatchedClusters[2][ii].empty()){continue;}
@@ -554,7 +572,7 @@ void LowEAna::analyze(art::Event const & evt){
     // --- Remaining are MainCls
     Idx = ii;
     if (!MatchedClusters[0][ii].empty() && !MatchedClusters[1][ii].empty()){
-      lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind0 & Ind1 #"+str(ii),GetColor("green"));
+      if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind0 & Ind1 #"+str(ii),GetColor("green"));
       // --- Declare our vectors to fill
       std::vector<double> Dir, Ind0Dir, Ind1Dir;
       Dir = Ind0Dir = Ind1Dir = {};
@@ -578,7 +596,7 @@ void LowEAna::analyze(art::Event const & evt){
       // --- Declare our vectors to fill
       std::vector<double> Dir, Ind0Dir;
       Dir = Ind0Dir = {};
-      lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind0 #"+str(ii),GetColor("green"));
+      if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind0 #"+str(ii),GetColor("green"));
       FillClusterHitVectors(MatchedClusters[0][ii], Ind0TPC, Ind0Channel, Ind0MotherX, Ind0MotherY, Ind0MotherZ, Ind0MotherE, Ind0MotherP, Ind0MotherPDG, Ind0AncestorX, Ind0AncestorY, Ind0AncestorZ, Ind0AncestorE, Ind0AncestorP, Ind0AncestorPDG, Ind0Charge, Ind0T, Ind0Y, Ind0Z, Ind0Dir, clockData, fDebug);
       FillClusterHitVectors(MatchedClusters[2][ii], TPC, Channel, MotherX, MotherY, MotherZ, MotherE, MotherP, MotherPDG, AncestorX, AncestorY, AncestorZ, AncestorE, AncestorP, AncestorPDG, Charge, Time, Y, Z, Dir, clockData, fDebug);
       Y = ComputeInterpolationRecoY(Event,Ind0TPC,Z,Time,Ind0Z,Ind0Y,Ind0T,Ind0Dir,fDebug);
@@ -594,7 +612,7 @@ void LowEAna::analyze(art::Event const & evt){
       // --- Declare our vectors to fill
       std::vector<double> Dir, Ind1Dir;
       Dir = Ind1Dir = {};
-      lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind1 #"+str(ii),GetColor("green"));
+      if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"Found MainCl with match in Ind1 #"+str(ii),GetColor("green"));
       FillClusterHitVectors(MatchedClusters[1][ii], Ind1TPC, Ind1Channel, Ind1MotherX, Ind1MotherY, Ind1MotherZ, Ind1MotherE, Ind1MotherP, Ind1MotherPDG, Ind1AncestorX, Ind1AncestorY, Ind1AncestorZ, Ind1AncestorE, Ind1AncestorP, Ind1AncestorPDG, Ind1Charge, Ind1T, Ind1Y, Ind1Z, Ind1Dir, clockData, fDebug);
       FillClusterHitVectors(MatchedClusters[2][ii], TPC, Channel, MotherX, MotherY, MotherZ, MotherE, MotherP, MotherPDG, AncestorX, AncestorY, AncestorZ, AncestorE, AncestorP, AncestorPDG, Charge, Time, Y, Z, Dir, clockData, fDebug);
       Y = ComputeInterpolationRecoY(Event,Ind1TPC,Z,Time,Ind1Z,Ind1Y,Ind1T,Ind1Dir,fDebug);
@@ -606,14 +624,14 @@ void LowEAna::analyze(art::Event const & evt){
       fLowEAnaTree->Fill();
       ResetClusterVariables();
     }
-    else{lpreselectionstr = PrintInColor(lpreselectionstr,"No match found! THIS SHOULD NOT HAPPEN, CLUSTERS HAVE ALREADY BEEN MATCHED!",GetColor("red"));}
+    else if (fLogInfo) {lpreselectionstr = PrintInColor(lpreselectionstr,"No match found! THIS SHOULD NOT HAPPEN, CLUSTERS HAVE ALREADY BEEN MATCHED!",GetColor("red"));}
 
     for (int jj = 0; jj < int(MatchedClusters[2].size()); jj++){
       if (jj == ii){continue;}
       if (MatchedClusters[2][jj].empty()){continue;}
       if (abs(ClT[2][ii] - ClT[2][jj]) > fAdjClusterTime){continue;}
       if (!MatchedClusters[0][jj].empty() && !MatchedClusters[1][jj].empty()){
-        lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl cluster found!",GetColor("green"));
+        if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl cluster found!",GetColor("green"));
         // --- Declare our vectors to fill
         std::vector<double> Dir, Ind0Dir, Ind1Dir;
         Dir = Ind0Dir = Ind1Dir = {};
@@ -633,7 +651,7 @@ void LowEAna::analyze(art::Event const & evt){
         ResetClusterVariables();
       }
       else if (!MatchedClusters[0][jj].empty() && MatchedClusters[1][jj].empty()){
-        lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl found!",GetColor("green"));
+        if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl found!",GetColor("green"));
         // --- Declare our vectors to fill
         std::vector<double> Dir, Ind0Dir;
         Dir = Ind0Dir = {};
@@ -651,7 +669,7 @@ void LowEAna::analyze(art::Event const & evt){
         // --- Declare our vectors to fill
         std::vector<double> Dir, Ind1Dir;
         Dir = Ind1Dir = {};
-        lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl found!",GetColor("green"));
+        if (fLogInfo) lpreselectionstr = PrintInColor(lpreselectionstr,"AdjCl found!",GetColor("green"));
         FillClusterHitVectors(MatchedClusters[1][jj], Ind1TPC, Ind1Channel, Ind1MotherX, Ind1MotherY, Ind1MotherZ, Ind1MotherE, Ind1MotherP, Ind1MotherPDG, Ind1AncestorX, Ind1AncestorY, Ind1AncestorZ, Ind1AncestorE, Ind1AncestorP, Ind1AncestorPDG, Ind1Charge, Ind1T, Ind1Y, Ind1Z, Ind1Dir, clockData, fDebug);
         FillClusterHitVectors(MatchedClusters[2][jj], TPC, Channel, MotherX, MotherY, MotherZ, MotherE, MotherP, MotherPDG, AncestorX, AncestorY, AncestorZ, AncestorE, AncestorP, AncestorPDG, Charge, Time, Y, Z, Dir, clockData, fDebug);
         Y = ComputeInterpolationRecoY(Event,Ind1TPC,Z,Time,Ind1Z,Ind1Y,Ind1T,Ind1Dir,fDebug);
@@ -663,7 +681,9 @@ void LowEAna::analyze(art::Event const & evt){
         ResetClusterVariables();
       }
     } // End of loop over AdjCl
+    if (fLogInfo) mf::LogInfo("preselection") << lpreselectionstr;
   } // Loop over MainCl
+  mf::LogDebug("hits") << "\nHit truth memo: " << fHitTruthMemoHits << " hits / " << fHitTruthMemoMisses << " misses over " << fHitTruthMemo.size() << " hits";
 } // End of analyze
 
 //########################################################################################################################################//
@@ -689,15 +709,20 @@ void LowEAna::ResetEventVariables( detinfo::DetectorClocksData clockData )
 // Reset variables for each event
 {
   Flag = rand() % 10000000000;
-  mf::LogInfo lheader("header");
-  lheader << "\n#####################################################################";
-  lheader << "\n - TPC Frequency in [MHz]: " << clockData.TPCClock().Frequency()      ;
-  lheader << "\n - TPC Tick in [us]: " << clockData.TPCClock().TickPeriod()           ;
-  lheader << "\n - Event Flag: " << Flag                                              ;
-  lheader << "\n - Succesfull reset of variables for Event " << Event << ": " << Flag ; 
-  lheader << "\n#####################################################################";
+  if (fLogInfo){
+    mf::LogInfo lheader("header");
+    lheader << "\n#####################################################################";
+    lheader << "\n - TPC Frequency in [MHz]: " << clockData.TPCClock().Frequency()      ;
+    lheader << "\n - TPC Tick in [us]: " << clockData.TPCClock().TickPeriod()           ;
+    lheader << "\n - Event Flag: " << Flag                                              ;
+    lheader << "\n - Succesfull reset of variables for Event " << Event << ": " << Flag ; 
+    lheader << "\n#####################################################################";
+  }
   // Clear Marley MCTruth info.
   Parts = {}; TPart = {};
+  // Clear the hit truth memo
+  fHitTruthMemo.clear();
+  fHitTruthMemoHits = fHitTruthMemoMisses = 0;
   Idx = 0;
   // Clear OpFlash Vectors
   OpFlashGen.clear();OpFlashPur.clear();OpFlashNHit.clear();OpFlashPE.clear();OpFlashMaxPE.clear();
@@ -773,37 +798,70 @@ std::vector<double> LowEAna::ComputeInterpolationRecoY(
 /*
 */
 { 
-  mf::LogInfo linterp("interpolation");
   std::string linterpstr = "";
-  // Create the interpolator
+  // Build the interpolator over the time-sorted induction hits
   std::vector<double> RecoY = {};
-
-  // TFile * f = new TFile(("Interpolation"+str(Event)+"_"+str(Time[0])+".root").c_str(),"RECREATE");
-  TGraph * IndInterpZ = new TGraph();
-  TGraph * IndInterpY = new TGraph();
-  for (size_t i = 0; i < IndT.size(); i++){
-    // Fill TGraphs
-    IndInterpY->SetPoint(i, IndT[i], IndY[i]);
-    IndInterpZ->SetPoint(i, IndT[i], IndZ[i]);
-  }
+  RecoY.reserve(Z.size());
+  fInterpolation.Build(IndT, IndY, IndZ);
 
   for (size_t i = 0; i < Z.size(); i++){
     float ThisHZ = Z[i];
     float ThisHT = Time[i];
     float ThisHIndDir = IndDir[0];
-    float ThisHRefY = IndInterpY->Eval(ThisHT);
-    float ThisHRefZ = IndInterpZ->Eval(ThisHT);
+    double RefY = 0, RefZ = 0;
+    fInterpolation.Eval(ThisHT, RefY, RefZ);
+    float ThisHRefY = RefY;
+    float ThisHRefZ = RefZ;
     float ThisRecoY = ThisHRefY + (ThisHZ - ThisHRefZ)/(ThisHIndDir);
     RecoY.push_back(ThisRecoY);
-    linterpstr = PrintInColor(linterpstr,"\nReco Y = "+str(ThisRecoY)+" cm",GetColor("red"));
+    if (fLogInfo) linterpstr = PrintInColor(linterpstr,"\nReco Y = "+str(ThisRecoY)+" cm",GetColor("red"));
   }
-  // IndInterpY->Write("InterpY");
-  // IndInterpZ->Write("InterpZ");
-  // f->Close();
-  linterp << linterpstr;
+  if (fLogInfo) mf::LogInfo("interpolation") << linterpstr;
   return RecoY;
 }
 
+//......................................................
+void LowEAna::InterpolationEngine::Build(const std::vector<double> &IndT, const std::vector<double> &IndY, const std::vector<double> &IndZ)
+/*
+Sort the induction points by time into the reusable buffers (ties keep their input order).
+*/
+{
+  Order.resize(IndT.size());
+  for (size_t i = 0; i < Order.size(); i++){Order[i] = i;}
+  std::stable_sort(Order.begin(), Order.end(), [&IndT](int a, int b){return IndT[a] < IndT[b];});
+  T.resize(Order.size()); Y.resize(Order.size()); Z.resize(Order.size());
+  for (size_t i = 0; i < Order.size(); i++){
+    T[i] = IndT[Order[i]];
+    Y[i] = IndY[Order[i]];
+    Z[i] = IndZ[Order[i]];
+  }
+}
+
+//......................................................
+void LowEAna::InterpolationEngine::Eval(double Time, double &RefY, double &RefZ) const
+/*
+Linear interpolation with a binary search, following TGraph::Eval: exact matches return the point,
+values outside the time range are extrapolated from the two outermost points and
+equal abscissae return the first point.
+*/
+{
+  const int N = T.size();
+  if (N == 0){RefY = RefZ = 0; return;}
+  if (N == 1){RefY = Y[0]; RefZ = Z[0]; return;}
+  int Up = std::lower_bound(T.begin(), T.end(), Time) - T.begin();
+  if (Up < N && T[Up] == Time){RefY = Y[Up]; RefZ = Z[Up]; return;}
+  int Low = 0;
+  if (Up == 0){Low = 0; Up = 1;}
+  else if (Up == N){
+    Up = std::lower_bound(T.begin(), T.end(), T[N-1]) - T.begin();
+    Low = Up > 0 ? std::lower_bound(T.begin(), T.end(), T[Up-1]) - T.begin() : Up;
+  }
+  else{Low = std::lower_bound(T.begin(), T.end(), T[Up-1]) - T.begin();}
+  if (T[Low] == T[Up]){RefY = Y[Low]; RefZ = Z[Low]; return;}
+  RefY = Y[Up] + (Time - T[Up]) * (Y[Low] - Y[Up]) / (T[Low] - T[Up]);
+  RefZ = Z[Up] + (Time - T[Up]) * (Z[Low] - Z[Up]) / (T[Low] - T[Up]);
+}
+
 //......................................................
 void LowEAna::FillClusterHitVectors(std::vector<recob::Hit> Cluster, 
   std::vector<int> &TPC,
@@ -833,24 +891,12 @@ void LowEAna::FillClusterHitVectors(std::vector<recob::Hit> Cluster,
   // --- Declare our vectors to fill
   std::vector<int> TrackID;
   TrackID = {};
-  for (recob::Hit ThisHit : Cluster){
-    std::vector< sim::TrackIDE > ThisHitID = bt_serv->HitToTrackIDEs(ClockData, ThisHit);
-    int MainTrID = 0;
-    float TopEFrac = 0;
-    
-    for (size_t i=0; i < ThisHitID.size(); ++i){
-      if (ThisHitID[i].energyFrac > TopEFrac){
-        TopEFrac = ThisHitID[i].energyFrac;
-        MainTrID = ThisHitID[i].trackID; 
-      }
-    }
+  for (const recob::Hit &ThisHit : Cluster){
+    int MainTrID = GetHitTruth(ThisHit, ClockData).MainTrackID;
     TrackID.push_back(MainTrID);
     
     // Call backtracker to get the particle from the trackID
-    const simb::MCParticle *HTruth;
-    int test = supress_stdout();
-    HTruth = pi_serv->TrackIdToParticle_P(MainTrID);
-    resume_stdout(test);
+    const simb::MCParticle *HTruth = TrackIdToParticle(MainTrID);
     if (HTruth != 0){
       MotherX.push_back(HTruth->Vx());
       MotherY.push_back(HTruth->Vy());
@@ -858,10 +904,7 @@ void LowEAna::FillClusterHitVectors(std::vector<recob::Hit> Cluster,
       MotherE.push_back(HTruth->E());
       MotherP.push_back(HTruth->P());
       MotherPDG.push_back(HTruth->PdgCode());
-      const simb::MCParticle *Ancestor;
-      int test = supress_stdout();
-      Ancestor = pi_serv->TrackIdToParticle_P(HTruth->Mother());
-      resume_stdout(test);
+      const simb::MCParticle *Ancestor = TrackIdToParticle(HTruth->Mother());
       
       if (Ancestor != 0){
         AncestorX.push_back(Ancestor->Vx());
@@ -1032,15 +1075,11 @@ Fill MCInteraction Tree with information about the main interaction in the event
 - HeavDebug is a boolean to turn on/off debugging statements
 */
 { 
-  mf::LogInfo lheader("header");
   std::string lheaderstr = "";
-  // Make a copy of MCParticleList to be used for finding Daughter info
-  std::map< int, simb::MCParticle> MCParticleListCopy = MCParticleList;
   bool FoundInteraction;
 
   if (ProcessList.empty()){
-    lheaderstr = PrintInColor(lheaderstr,"\n-> No processes in the list!",GetColor("red"));
-    lheader << lheaderstr;
+    if (fLogInfo) mf::LogInfo("header") << PrintInColor(lheaderstr,"\n-> No processes in the list!",GetColor("red"));
     return;  
   }
   
@@ -1048,9 +1087,9 @@ Fill MCInteraction Tree with information about the main interaction in the event
     FoundInteraction = false;    
     for ( std::map<int,simb::MCParticle>::iterator mainiter = MCParticleList.begin(); mainiter != MCParticleList.end(); mainiter++ ){
       if ( mainiter->second.Process() != ProcessList[j] && mainiter->second.EndProcess() != ProcessList[j]){continue;}
-      lheaderstr = lheaderstr+"\nFound a main interaction "+mainiter->second.EndProcess();
+      if (fLogInfo) lheaderstr = lheaderstr+"\nFound a main interaction "+mainiter->second.EndProcess();
       FoundInteraction = true;
-      simb::MCParticle MCParticle = mainiter->second;
+      const simb::MCParticle &MCParticle = mainiter->second;
       Interaction =  MCParticle.EndProcess();
       PDG =          MCParticle.PdgCode();
       Energy =       MCParticle.E();
@@ -1058,41 +1097,46 @@ Fill MCInteraction Tree with information about the main interaction in the event
       StartVertex = {MCParticle.Vx(),MCParticle.Vy(),MCParticle.Vz()};
       EndVertex =   {MCParticle.EndX(),MCParticle.EndY(),MCParticle.EndZ()};
       
+      // Sorted daughter TrackIDs, so that they are filled in the same order as the particle map
       std::vector<int> DaughterList = {};
+      DaughterList.reserve(MCParticle.NumberDaughters());
       for (int i = 0; i < MCParticle.NumberDaughters(); i++){
         DaughterList.push_back(MCParticle.Daughter(i));
       }
+      std::sort(DaughterList.begin(), DaughterList.end());
       // Print nice output with all the main interaction info
-      lheaderstr = PrintInColor(lheaderstr,"\nMain interacting particle for process "+mainiter->second.Process()+": ",GetColor("magenta"));
-      lheaderstr = PrintInColor(lheaderstr,"\nPDG ->\t"         + str(PDG),GetColor("cyan"));
-      lheaderstr = PrintInColor(lheaderstr,"\nEnergy ->\t"      + str(Energy),GetColor("cyan"));
-      lheaderstr = PrintInColor(lheaderstr,"\nMomentum ->\t"    + str(Momentum[0]) + " " + str(Momentum[1]) + " " + str(Momentum[2]),GetColor("cyan"));
-      lheaderstr = PrintInColor(lheaderstr,"\nStartVertex ->\t" + str(StartVertex[0]) + " " + str(StartVertex[1]) + " " + str(StartVertex[2]),GetColor("cyan"));
-      lheaderstr = PrintInColor(lheaderstr,"\nEndVertex ->\t"   + str(EndVertex[0]) + " " + str(EndVertex[1]) + " " + str(EndVertex[2]),GetColor("cyan"));
-
-      for ( std::map<int,simb::MCParticle>::iterator daughteriter = MCParticleListCopy.begin(); daughteriter != MCParticleListCopy.end(); daughteriter++ ){
-        for (size_t i = 0; i < DaughterList.size(); i++){
-          if (daughteriter->first == MCParticle.Daughter(i)){
-            DaughterPDG.push_back(daughteriter->second.PdgCode());
-            DaughterE.push_back(daughteriter->second.E());
-            DaughterPx.push_back(daughteriter->second.Px());
-            DaughterPy.push_back(daughteriter->second.Py());
-            DaughterPz.push_back(daughteriter->second.Pz());
-            DaughterStartVx.push_back(daughteriter->second.Vx());
-            DaughterStartVy.push_back(daughteriter->second.Vy());
-            DaughterStartVz.push_back(daughteriter->second.Vz());
-            DaughterEndVx.push_back(daughteriter->second.EndX());
-            DaughterEndVy.push_back(daughteriter->second.EndY());
-            DaughterEndVz.push_back(daughteriter->second.EndZ());
-          } // If the particle is a daughter of the main interaction
-        } // Loop over all daughters
-      } // Loop over all particles in the map
+      if (fLogInfo){
+        lheaderstr = PrintInColor(lheaderstr,"\nMain interacting particle for process "+mainiter->second.Process()+": ",GetColor("magenta"));
+        lheaderstr = PrintInColor(lheaderstr,"\nPDG ->\t"         + str(PDG),GetColor("cyan"));
+        lheaderstr = PrintInColor(lheaderstr,"\nEnergy ->\t"      + str(Energy),GetColor("cyan"));
+        lheaderstr = PrintInColor(lheaderstr,"\nMomentum ->\t"    + str(Momentum[0]) + " " + str(Momentum[1]) + " " + str(Momentum[2]),GetColor("cyan"));
+        lheaderstr = PrintInColor(lheaderstr,"\nStartVertex ->\t" + str(StartVertex[0]) + " " + str(StartVertex[1]) + " " + str(StartVertex[2]),GetColor("cyan"));
+        lheaderstr = PrintInColor(lheaderstr,"\nEndVertex ->\t"   + str(EndVertex[0]) + " " + str(EndVertex[1]) + " " + str(EndVertex[2]),GetColor("cyan"));
+      }
+
+      // Look up each daughter directly in the TrackID-keyed particle map
+      for (size_t i = 0; i < DaughterList.size(); i++){
+        std::map<int,simb::MCParticle>::const_iterator daughteriter = MCParticleList.find(DaughterList[i]);
+        if (daughteriter == MCParticleList.end()){continue;} // Daughter not generated by this label
+        DaughterPDG.push_back(daughteriter->second.PdgCode());
+        DaughterE.push_back(daughteriter->second.E());
+        DaughterPx.push_back(daughteriter->second.Px());
+        DaughterPy.push_back(daughteriter->second.Py());
+        DaughterPz.push_back(daughteriter->second.Pz());
+        DaughterStartVx.push_back(daughteriter->second.Vx());
+        DaughterStartVy.push_back(daughteriter->second.Vy());
+        DaughterStartVz.push_back(daughteriter->second.Vz());
+        DaughterEndVx.push_back(daughteriter->second.EndX());
+        DaughterEndVy.push_back(daughteriter->second.EndY());
+        DaughterEndVz.push_back(daughteriter->second.EndZ());
+      } // Loop over all daughters
       fInteractionTree -> Fill();
     } // Loop over all particles in the map
+    if (!fLogInfo) continue;
     if (!FoundInteraction) lheaderstr = PrintInColor(lheaderstr,"\n-> No main interaction found for process "+ProcessList[j]+"!",GetColor("yellow"));
     else lheaderstr = PrintInColor(lheaderstr,"\n-> Filled MCINteraction Tree for process "+ProcessList[j]+"!",GetColor("green"));
   } // Loop over all processes in the list
-  lheader << lheaderstr;
+  if (fLogInfo) mf::LogInfo("header") << lheaderstr;
   return;
 } // FillMCInteractionTree
 
@@ -1217,20 +1261,8 @@ Find adjacent hits in time and space:
         tick += hit.Integral()*hit.PeakTime();
         channel += hit.Integral()*hit.Channel();
         adcInt += hit.Integral();
-        std::vector< sim::TrackIDE > ThisHitID = bt_serv->HitToTrackIDEs(clockData, hit);
-        int MainTrID = 0;
-        float TopEFrac = 0;
-        
-        for (size_t i=0; i < ThisHitID.size(); ++i){
-          if (ThisHitID[i].energyFrac > TopEFrac){
-            TopEFrac = ThisHitID[i].energyFrac;
-            MainTrID = ThisHitID[i].trackID; 
-          }
-        }
-        const simb::MCParticle *HitMother;
-        int test = supress_stdout();
-        HitMother = pi_serv->TrackIdToParticle_P(MainTrID);
-        resume_stdout(test);
+        int MainTrID = GetHitTruth(hit, clockData).MainTrackID;
+        const simb::MCParticle *HitMother = TrackIdToParticle(MainTrID);
         if (HitMother != 0){
           std::cout << "Hit PDG" << HitMother->PdgCode() << std::endl;
           std::cout << "Hit E" << HitMother->E() << std::endl;
@@ -1270,6 +1302,31 @@ Essestially, this function tells you which generator a given particle can be ass
   return 0;
 }
 
+//......................................................
+const LowEAna::HitTruth& LowEAna::GetHitTruth( const recob::Hit &ThisHit, detinfo::DetectorClocksData const &ClockData )
+/*
+Return the backtracked truth summary of a hit (main TrackID, its energy fraction and generator index).
+The backtracker is only called the first time a hit is seen in the event, later calls are served from the memo.
+*/
+{
+  auto Key = std::make_tuple(ThisHit.Channel(), ThisHit.StartTick(), ThisHit.EndTick(), ThisHit.LocalIndex(), ThisHit.PeakTime());
+  auto It = fHitTruthMemo.find(Key);
+  if (It != fHitTruthMemo.end()){
+    fHitTruthMemoHits++;
+    return It->second;
+  }
+  fHitTruthMemoMisses++;
+  std::vector< sim::TrackIDE > ThisHitID = bt_serv->HitToTrackIDEs(ClockData, ThisHit);
+  HitTruth Truth = {0, 0};
+  for (size_t i=0; i < ThisHitID.size(); ++i){
+    if (ThisHitID[i].energyFrac > Truth.EnergyFrac){
+      Truth.EnergyFrac = ThisHitID[i].energyFrac;
+      Truth.MainTrackID = ThisHitID[i].trackID;
+    }
+  }
+  return fHitTruthMemo.emplace(Key, Truth).first->second;
+}
+
 //......................................................
 void LowEAna::FillMyMaps( std::map< int, simb::MCParticle> &MyMap, art::FindManyP<simb::MCParticle> Assn, art::ValidHandle< std::vector<simb::MCTruth> > Hand )
 /*
@@ -1288,8 +1345,8 @@ This function fills a map with the MCParticles from a given MCTruth
 
 //......................................................
 // This function checks if a given TrackID is in a given map
-bool LowEAna::InMyMap( int TrID, std::map< int, simb::MCParticle> ParMap ){
-  std::map<int, simb::MCParticle>::iterator ParIt;
+bool LowEAna::InMyMap( int TrID, const std::map< int, simb::MCParticle> &ParMap ){
+  std::map<int, simb::MCParticle>::const_iterator ParIt;
   ParIt = ParMap.find( TrID );
   if (ParIt != ParMap.end()) {return true;}
   else return false;
@@ -1324,22 +1381,12 @@ std::string LowEAna::str( std::vector<int> i ) {std::stringstream ss;for (int j
 std::string LowEAna::str( std::vector<double> i ) {std::stringstream ss;for (int j = 0; j < int(i.size()); j++){ss << i[j] << " ";}return ss.str();}
 std::string LowEAna::str( std::vector<float> i ) {std::stringstream ss;for (int j = 0; j < int(i.size()); j++){ss << i[j] << " ";}return ss.str();}
 
-int LowEAna::supress_stdout() {
-  std::fflush(stdout);
-
-  int ret = dup(1);
-  int nullfd = open("/dev/null", O_WRONLY);
-  // check nullfd for error omitted
-  dup2(nullfd, 1);
-  close(nullfd);
-
-  return ret;
-}
-
-void LowEAna::resume_stdout(int fd) {
-  std::fflush(stdout);
-  dup2(fd, 1);
-  close(fd);
+// Look the TrackID up in the particle list directly: TrackIdToParticle_P prints a warning for every ID that is not there
+const simb::MCParticle* LowEAna::TrackIdToParticle(int TrackID){
+  const sim::ParticleList& PartList = pi_serv->ParticleList();
+  sim::ParticleList::const_iterator It = PartList.find(TrackID);
+  if (It == PartList.end()) return 0;
+  return It->second;
 }
 
 //......................................................
@@ -49,6 +49,8 @@
 
 // c++
 #include <string>
+#include <map>
+#include <unordered_map>
 
 namespace showerAna {
   class ShowerAnalysis;
@@ -65,7 +67,7 @@ public:
 
   // Setters
   void SetEnergy(double energy);
-  void SetDepositedEnergy(std::map<int,double> depositedEnergy);
+  void SetDepositedEnergy(const std::map<int,double>& depositedEnergy);
   void SetDirection(TVector3 direction);
   void SetStart(TVector3 start);
   void SetEnd(TVector3 end);
@@ -147,7 +149,7 @@ void showerAna::ShowerParticle::SetEnergy(double energy) {
   fEnergy = energy;
 }
 
-void showerAna::ShowerParticle::SetDepositedEnergy(std::map<int,double> depositedEnergy) {
+void showerAna::ShowerParticle::SetDepositedEnergy(const std::map<int,double>& depositedEnergy) {
   fDepositedEnergy = depositedEnergy;
 }
 
@@ -292,6 +294,20 @@ void showerAna::ShowerAnalysis::analyze(const art::Event& evt) {
   bool isPi0 = false;
   std::vector<int> pi0Decays;
 
+  // Deposited energy of each true particle (by track ID), per plane, in a single pass over the sim channels
+  std::unordered_map<int,std::map<int,double> > depositedEnergies;
+  const std::vector<art::Ptr< sim::SimChannel >>& simChannels = bt_serv->SimChannels();
+  for (std::vector<art::Ptr< sim::SimChannel >>::const_iterator channelIt = simChannels.begin(); channelIt != simChannels.end(); ++channelIt) {
+    int plane = geom->View((*channelIt)->Channel());
+    auto const & tdcidemap = (*channelIt)->TDCIDEMap();
+    for (auto const& tdcIt : tdcidemap) {
+      auto const& idevec = tdcIt.second;
+      for (auto const& ideIt : idevec)
+        depositedEnergies[TMath::Abs(ideIt.trackID)][plane] += ideIt.energy / 1000;
+    }
+  }
+  const std::map<int,double> noDepositedEnergy;
+
   // Fill true properties
   const sim::ParticleList& trueParticles = pi_serv->ParticleList();
   for (sim::ParticleList::const_iterator particleIt = trueParticles.begin(); particleIt != trueParticles.end(); ++particleIt) {
@@ -303,20 +319,9 @@ void showerAna::ShowerAnalysis::analyze(const art::Event& evt) {
       pi0Decays.push_back(particleIt->first);
     }
 
-    std::map<int,double> depositedEnergy;
-    const std::vector<art::Ptr< sim::SimChannel >>& simChannels = bt_serv->SimChannels();
-    for (std::vector<art::Ptr< sim::SimChannel >>::const_iterator channelIt = simChannels.begin(); channelIt != simChannels.end(); ++channelIt) {
-      int plane = geom->View((*channelIt)->Channel());
-      auto const & tdcidemap = (*channelIt)->TDCIDEMap();
-      for (auto const& tdcIt : tdcidemap) {
-        auto const& idevec = tdcIt.second;
-        for (auto const& ideIt : idevec) {
-          if (TMath::Abs(ideIt.trackID) != trueParticle->TrackId())
-            continue;
-          depositedEnergy[plane] += ideIt.energy / 1000;
-        }
-      }
-    }
+    auto depositedEnergyIt = depositedEnergies.find(trueParticle->TrackId());
+    const std::map<int,double>& depositedEnergy
+      = (depositedEnergyIt != depositedEnergies.end())? depositedEnergyIt->second: noDepositedEnergy;
 
     std::shared_ptr<ShowerParticle> particle = std::make_shared<ShowerParticle>(trueParticle->TrackId());
     particle->SetEnergy(trueParticle->E());
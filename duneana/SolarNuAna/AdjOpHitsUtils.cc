@@ -11,79 +11,110 @@ namespace solar
         fOpFlashAlgoDebug(p.get<bool>("OpFlashAlgoDebug"))
   {
   }
-  void AdjOpHitsUtils::MakeFlashVector(std::vector<FlashInfo> &FlashVec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, art::Event const &evt){
-    // This is the constructor for the OpFlash object
-    // OpFlash (double time, double timewidth, double abstime, unsigned int frame, std::vector< double > PEperOpDet, bool InBeamFrame=0, int OnBeamTime=0, double FastToTotal=1, double yCenter=0, double yWidth=0, double zCenter=0, double zWidth=0, std::vector< double > WireCenters=std::vector< double >(0), std::vector< double > WireWidths=std::vector< double >(0))
-    auto assns = std::make_unique<art::Assns<recob::OpFlash, recob::OpHit>>(); 
-    
-    for (std::vector<art::Ptr<recob::OpHit>> Cluster : Clusters)
+  const TVector3 &AdjOpHitsUtils::GetOpDetCenter(int OpChannel)
+  {
+    if (OpChannel >= int(fOpDetCenters.size()))
+    {
+      fOpDetCenters.resize(OpChannel + 1);
+      fOpDetCenterFilled.resize(OpChannel + 1, false);
+    }
+    if (!fOpDetCenterFilled[OpChannel])
+    {
+      auto OpDetXYZ = geo->OpDetGeoFromOpChannel(OpChannel).GetCenter();
+      fOpDetCenters[OpChannel] = TVector3(OpDetXYZ.X(), OpDetXYZ.Y(), OpDetXYZ.Z());
+      fOpDetCenterFilled[OpChannel] = true;
+    }
+    return fOpDetCenters[OpChannel];
+  }
+
+  void AdjOpHitsUtils::MakeFlashVector(std::vector<FlashInfo> &FlashVec, const std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, art::Event const &evt){
+    FlashVec.reserve(FlashVec.size() + Clusters.size());
+    for (const std::vector<art::Ptr<recob::OpHit>> &Cluster : Clusters)
     {
-      std::vector<art::Ptr<recob::OpHit>> ClusterCopy = Cluster;
-      std::sort(ClusterCopy.begin(), ClusterCopy.end(), [](art::Ptr<recob::OpHit> a, art::Ptr<recob::OpHit> b) { return a->PeakTime() < b->PeakTime(); });
+      // Keep the flashes aligned with the clusters even if an empty cluster is passed
+      if (Cluster.empty())
+      {
+        FlashVec.push_back(FlashInfo{0, 0, 0, 0, 0, {}, 0, 0, 0, 0, 0, 0});
+        continue;
+      }
+      // Walk the cluster in time order through an index span instead of copying and sorting it
+      const int NHitTot = Cluster.size();
+      fHitOrder.resize(NHitTot);
+      fHitTimes.resize(NHitTot);
+      fHitPECumSum.resize(NHitTot + 1);
+      std::iota(fHitOrder.begin(), fHitOrder.end(), 0);
+      std::sort(fHitOrder.begin(), fHitOrder.end(), [&Cluster](int a, int b) { return Cluster[a]->PeakTime() < Cluster[b]->PeakTime(); });
+
       int NHit = 0;
-      double Time = ClusterCopy[0]->PeakTime();
-      double TimeWidth = 0;
-      double TimeSum = 0;
       double PE = 0;
       double MaxPE = 0;
       std::vector<double> PEperOpDet = {};
+      PEperOpDet.reserve(NHitTot);
       double FastToTotal = 1;
       double X = 0;
       double Y = 0;
       double Z = 0;
-      double YWidth = 0;
-      double ZWidth = 0;
-      double XSum = 0;
-      double YSum = 0;
-      double ZSum = 0;
-      
-      for (art::Ptr<recob::OpHit> PDSHit : ClusterCopy)
+      // Moments are accumulated relative to the first hit to keep the single-pass widths numerically stable
+      const double T0 = Cluster[fHitOrder[0]]->PeakTime();
+      const TVector3 &FirstXYZ = GetOpDetCenter(Cluster[fHitOrder[0]]->OpChannel());
+      const double Y0 = FirstXYZ.Y();
+      const double Z0 = FirstXYZ.Z();
+      double TimeSum = 0, XSum = 0, YSum = 0, ZSum = 0;
+      double dTSum = 0, dTSum2 = 0, dYSum = 0, dYSum2 = 0, dZSum = 0, dZSum2 = 0;
+      fHitPECumSum[0] = 0;
+
+      for (int k = 0; k < NHitTot; k++)
       {
+        const art::Ptr<recob::OpHit> &PDSHit = Cluster[fHitOrder[k]];
+        const double HitPE = PDSHit->PE();
+        const double dT = PDSHit->PeakTime() - T0;
+        const TVector3 &OpHitXYZ = GetOpDetCenter(PDSHit->OpChannel());
+        const double dY = OpHitXYZ.Y() - Y0;
+        const double dZ = OpHitXYZ.Z() - Z0;
         NHit++;
-        PE += PDSHit->PE();
-        if (PDSHit->PE() > MaxPE)
-          MaxPE = PDSHit->PE();
-        PEperOpDet.push_back(PDSHit->PE());
-        TimeSum += PDSHit->PeakTime() * PDSHit->PE();
-        auto OpHitXYZ = geo->OpDetGeoFromOpChannel(PDSHit->OpChannel()).GetCenter();
-        XSum += OpHitXYZ.X() * PDSHit->PE();
-        YSum += OpHitXYZ.Y() * PDSHit->PE();
-        ZSum += OpHitXYZ.Z() * PDSHit->PE();
+        PE += HitPE;
+        if (HitPE > MaxPE)
+          MaxPE = HitPE;
+        PEperOpDet.push_back(HitPE);
+        TimeSum += dT * HitPE;
+        XSum += OpHitXYZ.X() * HitPE;
+        YSum += dY * HitPE;
+        ZSum += dZ * HitPE;
+        dTSum += dT;
+        dTSum2 += dT * dT;
+        dYSum += dY;
+        dYSum2 += dY * dY;
+        dZSum += dZ;
+        dZSum2 += dZ * dZ;
+        fHitTimes[k] = PDSHit->PeakTime();
+        fHitPECumSum[k + 1] = fHitPECumSum[k] + HitPE;
       }
-      Time = TimeSum / PE;
+      double Time = T0 + TimeSum / PE;
       X = XSum / PE;
-      Y = YSum / PE;
-      Z = ZSum / PE;
+      Y = Y0 + YSum / PE;
+      Z = Z0 + ZSum / PE;
       // Alternatively compute the centroid of the flash in 3D space
       if (fOpFlashAlgoCentroid) 
       { 
-        CalcCentroid(ClusterCopy, X, Y, Z);
+        CalcCentroid(Cluster, fHitOrder, X, Y, Z);
       }
 
-      for (art::Ptr<recob::OpHit> PDSHit : ClusterCopy)
-      {
-        auto OpHitXYZ = geo->OpDetGeoFromOpChannel(PDSHit->OpChannel()).GetCenter();
-        TimeWidth += (PDSHit->PeakTime() - Time) * (PDSHit->PeakTime() - Time);
-        YWidth += (OpHitXYZ.Y() - Y) * (OpHitXYZ.Y() - Y);
-        ZWidth += (OpHitXYZ.Z() - Z) * (OpHitXYZ.Z() - Z);
-      }
-      TimeWidth = sqrt(TimeWidth / ClusterCopy.size());
-      YWidth = sqrt(YWidth / ClusterCopy.size());
-      ZWidth = sqrt(ZWidth / ClusterCopy.size());
+      // Sum of squared deviations around the final (Time, Y, Z) from the accumulated moments
+      const double a = Time - T0, b = Y - Y0, c = Z - Z0;
+      double TimeWidth = sqrt(std::max(0., dTSum2 - 2 * a * dTSum + NHitTot * a * a) / NHitTot);
+      double YWidth = sqrt(std::max(0., dYSum2 - 2 * b * dYSum + NHitTot * b * b) / NHitTot);
+      double ZWidth = sqrt(std::max(0., dZSum2 - 2 * c * dZSum + NHitTot * c * c) / NHitTot);
       
       // Compute FastToTotal according to the #PEs arriving within the first 10% of the time window wrt the total #PEs
-      for (art::Ptr<recob::OpHit> PDSHit : ClusterCopy)
-      {
-        if (PDSHit->PeakTime() < Time + TimeWidth / 10)
-          FastToTotal += PDSHit->PE();
-      }
+      auto FastEnd = std::lower_bound(fHitTimes.begin(), fHitTimes.begin() + NHitTot, Time + TimeWidth / 10);
+      FastToTotal += fHitPECumSum[FastEnd - fHitTimes.begin()];
       FastToTotal /= PE;
-      FlashVec.push_back(FlashInfo{NHit, Time, TimeWidth, PE, MaxPE, PEperOpDet, FastToTotal, X, Y, Z, YWidth, ZWidth});
+      FlashVec.push_back(FlashInfo{NHit, Time, TimeWidth, PE, MaxPE, std::move(PEperOpDet), FastToTotal, X, Y, Z, YWidth, ZWidth});
     }
     return;
   }
 
-  void AdjOpHitsUtils::CalcAdjOpHitsFast(std::vector<art::Ptr<recob::OpHit>> Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug)
+  void AdjOpHitsUtils::CalcAdjOpHitsFast(const std::vector<art::Ptr<recob::OpHit>> &Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug)
   {
     const float TimeRange = fOpFlashAlgoTime;       // Time in ns
     const float RadRange  = fOpFlashAlgoRad;        // Range in cm
@@ -92,6 +123,7 @@ namespace solar
 
     // Define MyVec as a copy of the input vector but only with hits with PE > MinPE
     std::vector<art::Ptr<recob::OpHit>> MyVec;
+    MyVec.reserve(Vec.size());
     for (const auto &hit : Vec)
     {
       if (hit->PE() >= MinPE)
@@ -99,20 +131,13 @@ namespace solar
     }
 
     // Sort hits according to time
-    std::sort(MyVec.begin(), MyVec.end(), [](art::Ptr<recob::OpHit> a, art::Ptr<recob::OpHit> b) { return a->PeakTime() < b->PeakTime(); });
+    std::sort(MyVec.begin(), MyVec.end(), [](const art::Ptr<recob::OpHit> &a, const art::Ptr<recob::OpHit> &b) { return a->PeakTime() < b->PeakTime(); });
     if (HeavDebug) std::cout << "Selected ophits " << MyVec.size() << " from " << Vec.size() << std::endl;
 
-    // Pre-calculate OpDet center coordinates
-    std::unordered_map<int, TVector3> opDetCenters;
+    // Make sure the job-wide OpDet center table covers all the channels of this event
     for (const auto &hit : MyVec)
-    {
-      int opChannel = hit->OpChannel();
-      if (opDetCenters.find(opChannel) == opDetCenters.end())
-      {
-        auto opDetXYZ = geo->OpDetGeoFromOpChannel(opChannel).GetCenter();
-        opDetCenters[opChannel] = TVector3(opDetXYZ.X(), opDetXYZ.Y(), opDetXYZ.Z());
-      }
-    }
+      GetOpDetCenter(hit->OpChannel());
+    const std::vector<TVector3> &opDetCenters = fOpDetCenters;
     // Create a vector of bools to track if a hit has been clustered or not
     std::vector<bool> ClusteredHits(MyVec.size(), false);
     // Don't need cluster all the hits, only those with PE > MinPE that are close to a big hit
@@ -183,121 +208,137 @@ namespace solar
     return;
   }
 
-  void AdjOpHitsUtils::CalcAdjOpHits(std::vector<art::Ptr<recob::OpHit>> Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug)
+  void AdjOpHitsUtils::CalcAdjOpHits(const std::vector<art::Ptr<recob::OpHit>> &Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug)
   {
     const float TimeRange = fOpFlashAlgoTime; // Time in ns
     const float RadRange = fOpFlashAlgoRad;   // Range in cm
     const float MinPE = fOpFlashAlgoPE;       // Minimum PE for a hit to be considered
-    unsigned int FilledHits = 0;
     
     // Define MyVec as a copy of the input vector but only with hits with PE > MinPE
     std::vector<art::Ptr<recob::OpHit>> MyVec;
+    MyVec.reserve(Vec.size());
     for (const auto &hit : Vec)
     {
       if (hit->PE() >= MinPE)
         MyVec.push_back(hit);
     }
-    unsigned int NumOriHits = MyVec.size();
+    const int NumOriHits = MyVec.size();
 
-    // Pre-calculate OpDet center coordinates
-    std::unordered_map<int, TVector3> opDetCenters;
+    // Make sure the job-wide OpDet center table covers all the channels of this event
     for (const auto &hit : MyVec)
+      GetOpDetCenter(hit->OpChannel());
+    const std::vector<TVector3> &opDetCenters = fOpDetCenters;
+
+    // Bucket the hits in (time, X, Y, Z) cells slightly larger than the clustering ranges, so that two adjacent hits
+    // are always in neighbouring cells. A non-positive range collapses that coordinate to a single bin.
+    // Hits with non-finite time or position can never be adjacent to anything and are left out of the buckets.
+    const double TimeCell = TimeRange > 0 ? TimeRange * (1 + 1e-6) : 0;
+    const double RadCell = RadRange > 0 ? RadRange * (1 + 1e-6) : 0;
+    auto CellIndex = [](double Value, double Cell) { return Cell > 0 ? long(std::floor(Value / Cell)) : 0L; };
+    const long TimeSpan = TimeCell > 0 ? 1 : 0;
+    const long RadSpan = RadCell > 0 ? 1 : 0;
+    std::map<std::array<long, 4>, std::vector<int>> Buckets;
+    std::vector<std::array<long, 4>> HitCell(NumOriHits);
+    std::vector<bool> HitBinned(NumOriHits, false);
+    for (int i = 0; i < NumOriHits; i++)
     {
-      int opChannel = hit->OpChannel();
-      if (opDetCenters.find(opChannel) == opDetCenters.end())
-      {
-        auto opDetXYZ = geo->OpDetGeoFromOpChannel(opChannel).GetCenter();
-        opDetCenters[opChannel] = TVector3(opDetXYZ.X(), opDetXYZ.Y(), opDetXYZ.Z());
-      }
+      const TVector3 &XYZ = opDetCenters[MyVec[i]->OpChannel()];
+      const double Time = MyVec[i]->PeakTime();
+      if (!std::isfinite(Time) || !std::isfinite(XYZ.X()) || !std::isfinite(XYZ.Y()) || !std::isfinite(XYZ.Z()))
+        continue;
+      HitCell[i] = {CellIndex(Time, TimeCell), CellIndex(XYZ.X(), RadCell), CellIndex(XYZ.Y(), RadCell), CellIndex(XYZ.Z(), RadCell)};
+      HitBinned[i] = true;
+      Buckets[HitCell[i]].push_back(i);
     }
 
-    while (NumOriHits != FilledHits)
+    // Grow each cluster from the first unclustered hit, one pass of adjacent hits at a time. Every pass only searches
+    // the buckets around the hits added in the previous one (hits adjacent to older members were already taken) and
+    // appends its hits in reverse input order.
+    std::vector<bool> Clustered(NumOriHits, false);
+    std::vector<int> Frontier, AddNow;
+    for (int Seed = 0; Seed < NumOriHits; Seed++)
     {
+      if (Clustered[Seed])
+        continue;
       if (HeavDebug)
         std::cerr << "\nStart of my while loop" << std::endl;
 
       std::vector<art::Ptr<recob::OpHit>> AdjHitVec;
-      AdjHitVec.reserve(MyVec.size());
-      AdjHitVec.push_back(MyVec[0]);
-      MyVec.erase(MyVec.begin() + 0);
-      int LastSize = 0;
-      int NewSize = AdjHitVec.size();
+      AdjHitVec.push_back(MyVec[Seed]);
+      Clustered[Seed] = true;
+      Frontier.assign(1, Seed);
 
-      while (LastSize != NewSize)
+      while (!Frontier.empty())
       {
-        std::vector<int> AddNow;
-        for (const auto &adjHit : AdjHitVec)
+        AddNow.clear();
+        for (int adjIdx : Frontier)
         {
-          for (auto it = MyVec.begin(); it != MyVec.end();)
-          {
-            const auto &myHit = *it;
-            if (HeavDebug)
-            {
-              std::cerr << "Looping though AdjVec and MyVec: AdjHitVec - " << adjHit->OpChannel() << " & " << adjHit->PeakTime() << std::endl
-              << "MVec - " << myHit->OpChannel() << " & " << myHit->PeakTime() << std::endl
-              << "Time " << std::abs(adjHit->PeakTime() - myHit->PeakTime()) << " bool " << (std::abs(adjHit->PeakTime() - myHit->PeakTime()) <= TimeRange)
-              << std::endl;
-            }
-
-            int adjOpChannel = adjHit->OpChannel();
-            int myOpChannel = myHit->OpChannel();
-            double adjPeakTime = adjHit->PeakTime();
-            double myPeakTime = myHit->PeakTime();
-
-            auto adjHitXYZ = opDetCenters[adjOpChannel];
-            auto myHitXYZ = opDetCenters[myOpChannel];
-
-            if ((adjHitXYZ - myHitXYZ).Mag() <= RadRange &&
-                std::abs(adjPeakTime - myPeakTime) <= TimeRange)
-            {
-              // --- Check that this element isn't already in AddNow.
-              if (std::find(AddNow.begin(), AddNow.end(), std::distance(MyVec.begin(), it)) == AddNow.end())
-                AddNow.push_back(std::distance(MyVec.begin(), it));
-            }
-            else
-            {
-              ++it;
-            }
-          }
+          if (!HitBinned[adjIdx])
+            continue;
+          const auto &adjHit = MyVec[adjIdx];
+          const TVector3 &adjHitXYZ = opDetCenters[adjHit->OpChannel()];
+          const double adjPeakTime = adjHit->PeakTime();
+          const std::array<long, 4> &Cell = HitCell[adjIdx];
+          for (long dt = -TimeSpan; dt <= TimeSpan; dt++)
+            for (long dx = -RadSpan; dx <= RadSpan; dx++)
+              for (long dy = -RadSpan; dy <= RadSpan; dy++)
+                for (long dz = -RadSpan; dz <= RadSpan; dz++)
+                {
+                  auto Bucket = Buckets.find({Cell[0] + dt, Cell[1] + dx, Cell[2] + dy, Cell[3] + dz});
+                  if (Bucket == Buckets.end())
+                    continue;
+                  for (int myIdx : Bucket->second)
+                  {
+                    if (Clustered[myIdx])
+                      continue;
+                    const auto &myHit = MyVec[myIdx];
+                    const double myPeakTime = myHit->PeakTime();
+                    if (HeavDebug)
+                    {
+                      std::cerr << "Looping though AdjVec and MyVec: AdjHitVec - " << adjHit->OpChannel() << " & " << adjPeakTime << std::endl
+                      << "MVec - " << myHit->OpChannel() << " & " << myPeakTime << std::endl
+                      << "Time " << std::abs(adjPeakTime - myPeakTime) << " bool " << (std::abs(adjPeakTime - myPeakTime) <= TimeRange)
+                      << std::endl;
+                    }
+                    if ((adjHitXYZ - opDetCenters[myHit->OpChannel()]).Mag() <= RadRange &&
+                        std::abs(adjPeakTime - myPeakTime) <= TimeRange)
+                    {
+                      Clustered[myIdx] = true;
+                      AddNow.push_back(myIdx);
+                    }
+                  }
+                }
         }
 
-        // --- Now loop through AddNow and remove from MyVec whilst adding to AdjHitVec
-        std::sort(AddNow.begin(), AddNow.end());
-        for (auto it = AddNow.rbegin(); it != AddNow.rend(); ++it)
+        // --- Now add the hits of this pass to AdjHitVec, in reverse input order
+        std::sort(AddNow.rbegin(), AddNow.rend());
+        for (int myIdx : AddNow)
         {
           if (HeavDebug)
           {
             std::cerr << "\tRemoving element from MyVec ===> "
-                      << MyVec[*it]->OpChannel() << " & " << MyVec[*it]->PeakTime()
+                      << MyVec[myIdx]->OpChannel() << " & " << MyVec[myIdx]->PeakTime()
                       << std::endl;
           }
-
-          AdjHitVec.push_back(MyVec[*it]);
-          MyVec.erase(MyVec.begin() + *it);
+          AdjHitVec.push_back(MyVec[myIdx]);
         }
+        Frontier.swap(AddNow);
 
-        LastSize = NewSize;
-        NewSize = AdjHitVec.size();
         if (HeavDebug)
         {
-          std::cerr << "\t---After that pass, AddNow was size " << AddNow.size() << " ==> LastSize is " << LastSize << ", and NewSize is " << NewSize
+          std::cerr << "\t---After that pass, AddNow was size " << Frontier.size() << " ==> NewSize is " << AdjHitVec.size()
                     << "\nLets see what is in AdjHitVec...." << std::endl;
           for (size_t aL = 0; aL < AdjHitVec.size(); ++aL)
           {
             std::cout << "\tElement " << aL << " is ===> " << AdjHitVec[aL]->OpChannel() << " & " << AdjHitVec[aL]->PeakTime() << std::endl;
           }
         }
-      } // while ( LastSize != NewSize )
-
-      int NumAdjColHits = AdjHitVec.size();
+      } // while (!Frontier.empty())
 
       if (HeavDebug)
-        std::cerr << "After that loop, I had " << NumAdjColHits << " adjacent collection plane hits." << std::endl;
-
-      FilledHits += NumAdjColHits;
+        std::cerr << "After that loop, I had " << AdjHitVec.size() << " adjacent collection plane hits." << std::endl;
 
-      if (AdjHitVec.size() > 0)
-        Clusters.push_back(std::move(AdjHitVec));
+      Clusters.push_back(std::move(AdjHitVec));
     }
 
     if (HeavDebug)
@@ -344,7 +385,14 @@ namespace solar
     return exp(-0.5 * pow((x - mean) / sigma, 2)) / (sqrt(2 * M_PI) * sigma);
   }
 
-  void AdjOpHitsUtils::CalcCentroid(std::vector<art::Ptr<recob::OpHit>> Hits, double &x, double &y, double &z)
+  void AdjOpHitsUtils::CalcCentroid(const std::vector<art::Ptr<recob::OpHit>> &Hits, double &x, double &y, double &z)
+  {
+    std::vector<int> Order(Hits.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    CalcCentroid(Hits, Order, x, y, z);
+  }
+
+  void AdjOpHitsUtils::CalcCentroid(const std::vector<art::Ptr<recob::OpHit>> &Hits, const std::vector<int> &Order, double &x, double &y, double &z)
   {
     const double sigma = fOpFlashAlgoRad; // Gaussian sigma (range in cm)
 
@@ -354,9 +402,10 @@ namespace solar
     double bestZ = 0.0;
 
     // Loop over possible x positions
-    double firstHitX = geo->OpDetGeoFromOpChannel(Hits[0]->OpChannel()).GetCenter().X();
-    double firstHitY = geo->OpDetGeoFromOpChannel(Hits[0]->OpChannel()).GetCenter().Y();
-    double firstHitZ = geo->OpDetGeoFromOpChannel(Hits[0]->OpChannel()).GetCenter().Z();
+    const TVector3 &firstHitXYZ = GetOpDetCenter(Hits[Order[0]]->OpChannel());
+    double firstHitX = firstHitXYZ.X();
+    double firstHitY = firstHitXYZ.Y();
+    double firstHitZ = firstHitXYZ.Z();
 
     for (double yPos = firstHitY - fOpFlashAlgoRad; yPos <= firstHitY + fOpFlashAlgoRad; yPos += 5)
     {
@@ -371,10 +420,11 @@ namespace solar
         int count = 0;
 
         // Loop over hits
-        for (const auto &hit : Hits)
+        for (int idx : Order)
         {
-          double hitYPos = geo->OpDetGeoFromOpChannel(hit->OpChannel()).GetCenter().Y();
-          double hitZPos = geo->OpDetGeoFromOpChannel(hit->OpChannel()).GetCenter().Z();
+          const TVector3 &hitXYZ = GetOpDetCenter(Hits[idx]->OpChannel());
+          double hitYPos = hitXYZ.Y();
+          double hitZPos = hitXYZ.Z();
 
           // Calculate the likelihood for the hit
           double hitLikelihood = GaussianPDF(hitYPos, yPos, sigma) * GaussianPDF(hitZPos, zPos, sigma);
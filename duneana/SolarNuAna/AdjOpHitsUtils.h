@@ -11,8 +11,12 @@
 #ifndef AdjOpHitsTool_h
 #define AdjOpHitsTool_h
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <vector>
 #include <fcntl.h>
 
@@ -31,6 +35,7 @@
 
 #include "TH1I.h"
 #include "TH1F.h"
+#include "TVector3.h"
 
 namespace solar
 {
@@ -53,15 +58,25 @@ namespace solar
                 double ZWidth;
             };
             explicit AdjOpHitsUtils( fhicl::ParameterSet const& p);
-            void MakeFlashVector(std::vector<FlashInfo> &FlashVec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, art::Event const &evt);
-            void CalcAdjOpHits(std::vector<art::Ptr<recob::OpHit>> Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug);
-            void CalcAdjOpHitsFast(std::vector<art::Ptr<recob::OpHit>> Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug);
-            void CalcCentroid(std::vector<art::Ptr<recob::OpHit>> Hits, double &x, double &y, double &z);
+            void MakeFlashVector(std::vector<FlashInfo> &FlashVec, const std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, art::Event const &evt);
+            void CalcAdjOpHits(const std::vector<art::Ptr<recob::OpHit>> &Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug);
+            void CalcAdjOpHitsFast(const std::vector<art::Ptr<recob::OpHit>> &Vec, std::vector<std::vector<art::Ptr<recob::OpHit>>> &Clusters, bool HeavDebug);
+            void CalcCentroid(const std::vector<art::Ptr<recob::OpHit>> &Hits, double &x, double &y, double &z);
             double GaussianPDF(double x, double mean, double sigma);
-            // Write a struct to store the flash information
+            // OpDet centre of an OpChannel, cached for the whole job. The reference is only valid until the next call.
+            const TVector3 &GetOpDetCenter(int OpChannel);
         
         private:
+            void CalcCentroid(const std::vector<art::Ptr<recob::OpHit>> &Hits, const std::vector<int> &Order, double &x, double &y, double &z);
+
             art::ServiceHandle<geo::Geometry> geo;
+            // OpChannel-indexed OpDet centres, filled on first use (the geometry does not change within a job)
+            std::vector<TVector3> fOpDetCenters;
+            std::vector<bool> fOpDetCenterFilled;
+            // Buffers reused across flashes to walk each cluster in time order without copying it
+            std::vector<int> fHitOrder;
+            std::vector<double> fHitTimes;
+            std::vector<double> fHitPECumSum;
             // From fhicl configuration
             const float fOpFlashAlgoTime;
             const float fOpFlashAlgoRad;
@@ -20,7 +20,10 @@
 #include "TH1F.h"
 #include "TH2F.h"
 #include "TTree.h"
-#include <fcntl.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
 #include "TRandom.h"
 #include "TVector3.h"
 
@@ -76,6 +79,8 @@ namespace solar
     bool InMyMap(int TrID, std::map<int, float> TrackIDMap);
     bool InMyMap(int TrID, std::map<int, simb::MCParticle> ParMap);
     void FillMyMaps(std::map<int, simb::MCParticle> &MyMap, art::FindManyP<simb::MCParticle> Assn, art::ValidHandle<std::vector<simb::MCTruth>> Hand);
+    void FindMatchCandidates(float ColTime, int ColNHits, float ColCharge, const std::vector<float> &SortedT, const std::vector<int> &SortedIdx, const std::vector<int> &IndNHits, const std::vector<float> &IndCharge, std::vector<int> &Candidates);
+    bool IsLogEnabled(std::string Type = "Info");
     void PrintInColor(std::string MyString, int MyColor, std::string Type = "Info");
     int GetColor(std::string MyString);
     std::string str(int MyInt);
@@ -84,8 +89,9 @@ namespace solar
     std::string str(std::vector<int> MyVec);
     std::string str(std::vector<float> MyVec, int MyPrecision = 2);
     std::string str(std::vector<double> MyVec, int MyPrecision = 2);
-    int supress_stdout();
-    void resume_stdout(int fd);
+
+    // --- Truth lookup that does not warn about TrackIDs missing from the particle list
+    const simb::MCParticle *TrackIdToParticle(int TrackID);
 
     // --- Our fcl parameter labels for the modules that made the data products
     std::string fRawDigitLabel, fHitLabel, fTrackLabel, fOpHitLabel, fOpFlashLabel, fGEANTLabel;
@@ -98,6 +104,9 @@ namespace solar
     float fOpFlashAlgoTime, fOpFlashAlgoRad, fOpFlashAlgoPE, fOpFlashAlgoTriggerPE;
     bool fClusterPreselectionTrack, fGenerateAdjOpFlash, fSaveMarleyEDep, fSaveSignalOpHits, fOpFlashAlgoCentroid, fOpFlashAlgoDebug;
 
+    // --- Logging levels enabled for the current event (summary strings are only built when printed)
+    bool fLogInfo;
+
     // --- Our TTrees, and its associated variables.
     TTree *fConfigTree;
     TTree *fMCTruthTree;
@@ -422,16 +431,20 @@ namespace solar
 
     // --- We want to reset all of our previous run and TTree variables ---
     ResetVariables();
+    fLogInfo = IsLogEnabled("Info");
     ThisGeneratorParts.clear();
     Event = evt.event();
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
     Flag = rand() % 10000000000;
     std::string sHead = "";
-    sHead = sHead + "\nTPC Frequency in [MHz]: " + str(clockData.TPCClock().Frequency());
-    sHead = sHead + "\nTPC Tick in [us]: " + str(clockData.TPCClock().TickPeriod());
-    sHead = sHead + "\nEvent Flag: " + str(Flag);
-    sHead = sHead + "\nSuccesfull reset of variables for evt " + str(Event);
-    sHead = sHead + "\n#########################################";
+    if (fLogInfo)
+    {
+      sHead = sHead + "\nTPC Frequency in [MHz]: " + str(clockData.TPCClock().Frequency());
+      sHead = sHead + "\nTPC Tick in [us]: " + str(clockData.TPCClock().TickPeriod());
+      sHead = sHead + "\nEvent Flag: " + str(Flag);
+      sHead = sHead + "\nSuccesfull reset of variables for evt " + str(Event);
+      sHead = sHead + "\n#########################################";
+    }
     PrintInColor(sHead, GetColor("magenta"));
 
     //---------------------------------------------------------------------------------------------------------------------------------------------------------------//
@@ -440,7 +453,7 @@ namespace solar
     // --- Fill MC Truth IDs to tracking vectors. Get a list of all of my particles in one chunk. ---
     const sim::ParticleList &PartList = pi_serv->ParticleList();
     std::string sMcTruth = "";
-    sMcTruth = sMcTruth + "\nThere are a total of " + str(int(PartList.size())) + " Particles in the event\n";
+    if (fLogInfo) sMcTruth = sMcTruth + "\nThere are a total of " + str(int(PartList.size())) + " Particles in the event\n";
 
     // Loop over all signal+bkg handles and collect track IDs
     for (size_t i = 0; i < fLabels.size(); i++)
@@ -455,14 +468,7 @@ namespace solar
         auto ThisValidHanlde = evt.getValidHandle<std::vector<simb::MCTruth>>(fLabels[i]); // Get generator handles
         art::FindManyP<simb::MCParticle> Assn(ThisValidHanlde, evt, fGEANTLabel);          // Assign labels to MCPArticles
         FillMyMaps(Parts[i], Assn, ThisValidHanlde);                                       // Fill empty list with previously assigned particles
-        if (Parts[i].size() < 1000)
-        {
-          sMcTruth = sMcTruth + "\n# of particles " + str(int(Parts[i].size())) + "\tfrom gen " + str(int(i)) + " " + fLabels[i];
-        }
-        else
-        {
-          sMcTruth = sMcTruth + "\n# of particles " + str(int(Parts[i].size())) + "\tfrom gen " + str(int(i)) + " " + fLabels[i];
-        }
+        if (fLogInfo) sMcTruth = sMcTruth + "\n# of particles " + str(int(Parts[i].size())) + "\tfrom gen " + str(int(i)) + " " + fLabels[i];
         TPart.push_back(Parts[i].size());
         for (std::map<int, simb::MCParticle>::iterator iter = Parts[i].begin(); iter != Parts[i].end(); iter++)
         {
@@ -473,7 +479,7 @@ namespace solar
       }
       else
       {
-        sMcTruth = sMcTruth + "\n# of particles " + str(int(Parts[i].size())) + "\tfrom gen " + str(int(i)) + " " + fLabels[i] + " *not generated!";
+        if (fLogInfo) sMcTruth = sMcTruth + "\n# of particles " + str(int(Parts[i].size())) + "\tfrom gen " + str(int(i)) + " " + fLabels[i] + " *not generated!";
         TPart.push_back(0);
         std::set<int> ThisGeneratorIDs = {};
         trackids.push_back(ThisGeneratorIDs);
@@ -503,14 +509,20 @@ namespace solar
         TNuY = nue.Nu().Vy();
         TNuZ = nue.Nu().Vz();
         int N = MARLEYtruth.NParticles();
-        sNuTruth = sNuTruth + "\nNeutrino Interaction: " + TNuInteraction;
-        sNuTruth = sNuTruth + "\nNumber of Producer Particles: " + str(N);
-        sNuTruth = sNuTruth + "\nNeutrino energy: " + str(TNuE) + " MeV";
-        sNuTruth = sNuTruth + "\nPosition (" + str(TNuX) + ", " + str(TNuY) + ", " + str(TNuZ) + ") cm";
+        if (fLogInfo)
+        {
+          sNuTruth = sNuTruth + "\nNeutrino Interaction: " + TNuInteraction;
+          sNuTruth = sNuTruth + "\nNumber of Producer Particles: " + str(N);
+          sNuTruth = sNuTruth + "\nNeutrino energy: " + str(TNuE) + " MeV";
+          sNuTruth = sNuTruth + "\nPosition (" + str(TNuX) + ", " + str(TNuY) + ", " + str(TNuZ) + ") cm";
+        }
       }
       art::FindManyP<simb::MCParticle> MarlAssn(MarlTrue, evt, fGEANTLabel);
-      sNuTruth = sNuTruth + "\nGen.\tPdgCode\t\tEnergy\t\tEndPosition\t\tMother";
-      sNuTruth = sNuTruth + "\n--------------------------------------------------------------------";
+      if (fLogInfo)
+      {
+        sNuTruth = sNuTruth + "\nGen.\tPdgCode\t\tEnergy\t\tEndPosition\t\tMother";
+        sNuTruth = sNuTruth + "\n--------------------------------------------------------------------";
+      }
 
       for (size_t i = 0; i < MarlAssn.size(); i++)
       {
@@ -564,13 +576,16 @@ namespace solar
           MarleyMaxEDepZList.push_back(MarleyMaxEDepZMap[(*part)->TrackId()]);
           SignalTrackIDs.emplace((*part)->TrackId());
 
-          if ((*part)->PdgCode() < 1000000)
-          {
-            sNuTruth = sNuTruth + "\n" + fLabels[0] + "\t" + str((*part)->PdgCode()) + "\t\t" + str(1e3*(*part)->E()) + "\t (" + str((*part)->EndX()) + ", " + str((*part)->EndY()) + ", " + str((*part)->EndZ()) + ")\t" + str((*part)->Mother());
-          }
-          else
+          if (fLogInfo)
           {
-            sNuTruth = sNuTruth + "\n" + fLabels[0] + "\t" + str((*part)->PdgCode()) + "\t" + str(1e3*(*part)->E()) + " (" + str((*part)->EndX()) + ", " + str((*part)->EndY()) + ", " + str((*part)->EndZ()) + ")\t" + str((*part)->Mother());
+            if ((*part)->PdgCode() < 1000000)
+            {
+              sNuTruth = sNuTruth + "\n" + fLabels[0] + "\t" + str((*part)->PdgCode()) + "\t\t" + str(1e3*(*part)->E()) + "\t (" + str((*part)->EndX()) + ", " + str((*part)->EndY()) + ", " + str((*part)->EndZ()) + ")\t" + str((*part)->Mother());
+            }
+            else
+            {
+              sNuTruth = sNuTruth + "\n" + fLabels[0] + "\t" + str((*part)->PdgCode()) + "\t" + str(1e3*(*part)->E()) + " (" + str((*part)->EndX()) + ", " + str((*part)->EndY()) + ", " + str((*part)->EndZ()) + ")\t" + str((*part)->Mother());
+            }
           }
 
           if ((*part)->PdgCode() == 11) // Electrons
@@ -666,7 +681,7 @@ namespace solar
               ThisOphitPurity /= int(ThisOpHitTrackIds.size());
             } 
             OpFlashPur += ThisOphitPurity;
-            auto OpHitXYZ = geo->OpDetGeoFromOpChannel(OpHit.OpChannel()).GetCenter();
+            const TVector3 &OpHitXYZ = adjophits->GetOpDetCenter(OpHit.OpChannel());
             SOpHitPur.push_back(ThisOphitPurity/int(ThisOpHitTrackIds.size()));
             SOpHitChannel.push_back(OpHit.OpChannel());
             SOpHitT.push_back(OpHit.PeakTime());
@@ -687,7 +702,7 @@ namespace solar
           if (abs(TheFlash.Time) < 20)
           {
             mf::LogDebug("SolarNuAna") << "Marley OpFlash PE (ratio/tot) " << TheFlash.MaxPE/TheFlash.PE << "/" << TheFlash.PE << " with purity " << OpFlashPur << " time " << TheFlash.Time; 
-            sOpFlashTruth += "Marley OpFlash PE (fast/ratio/tot) " + str(TheFlash.FastToTotal) + "/" + str(TheFlash.MaxPE/TheFlash.PE) + "/" +  str(TheFlash.PE) + " with purity " + str(OpFlashPur) + " time " + str(TheFlash.Time) + " vertex (" + str(TheFlash.X) + ", " + str(TheFlash.Y) + ", " + str(TheFlash.Z) + ")\n";
+            if (fLogInfo) sOpFlashTruth += "Marley OpFlash PE (fast/ratio/tot) " + str(TheFlash.FastToTotal) + "/" + str(TheFlash.MaxPE/TheFlash.PE) + "/" +  str(TheFlash.PE) + " with purity " + str(OpFlashPur) + " time " + str(TheFlash.Time) + " vertex (" + str(TheFlash.X) + ", " + str(TheFlash.Y) + ", " + str(TheFlash.Z) + ")\n";
           }
         }
       }
@@ -724,7 +739,7 @@ namespace solar
               ThisOphitPurity += 1;
             }
           } 
-          auto OpHitXYZ = geo->OpDetGeoFromOpChannel(OpHit.OpChannel()).GetCenter();
+          const TVector3 &OpHitXYZ = adjophits->GetOpDetCenter(OpHit.OpChannel());
           TotalFlashPE += OpHit.PE();
           FlashTime += OpHit.PeakTime()*OpHit.PE();
           if (OpHit.PE() > fAdjOpFlashMinPECut/NMatchedHits){
@@ -742,9 +757,7 @@ namespace solar
         FlashTime = FlashTime / TotalFlashPE;
 
         mf::LogDebug("SolarNuAna") << "Evaluating Flash purity";
-        int TerminalOutput = supress_stdout();
         double OpFlashPur = pbt->OpHitCollectionPurity(SignalTrackIDs, MatchedHits);
-        resume_stdout(TerminalOutput);
         mf::LogDebug("SolarNuAna") << "PE of this OpFlash " << TotalFlashPE << " OpFlash time " << FlashTime;
 
         // Calculate the flash purity, only for the Marley events
@@ -763,7 +776,7 @@ namespace solar
         if (abs(TheFlash.Time()) < 5)
         {
           mf::LogDebug("SolarNuAna") << "Marley OpFlash PE (max/tot) " << MaxOpHitPE << "/" << TheFlash.TotalPE() << " with purity " << OpFlashPur << " time " << TheFlash.Time(); 
-          sOpFlashTruth += "Marley OpFlash PE (max/tot) " + str(MaxOpHitPE) + "/" +  str(TheFlash.TotalPE()) + " with purity " + str(OpFlashPur) + " time " + str(TheFlash.Time()) + " vertex (" + str(TheFlash.YCenter()) + ", " + str(TheFlash.ZCenter()) + ")\n";
+          if (fLogInfo) sOpFlashTruth += "Marley OpFlash PE (max/tot) " + str(MaxOpHitPE) + "/" +  str(TheFlash.TotalPE()) + " with purity " + str(OpFlashPur) + " time " + str(TheFlash.Time()) + " vertex (" + str(TheFlash.YCenter()) + ", " + str(TheFlash.ZCenter()) + ")\n";
         }
       }
     }
@@ -830,11 +843,14 @@ namespace solar
     std::vector<std::vector<float>> ClPur = {{}, {}, {}}, Cldzdy = {{}, {}, {}};
 
     std::string sRecoObjects = "";
-    sRecoObjects += "\n# OpHits (" + fOpHitLabel + ") in full geometry: " + str(OpHitNum);
-    sRecoObjects += "\n# OpFlashes (" + fOpFlashLabel + ") in full geometry: " + str(OpFlashNum);
-    sRecoObjects += "\n# Hits (" + fHitLabel + ") in each view: " + str(int(ColHits0.size())) + ", " + str(int(ColHits1.size())) + ", " + str(int(ColHits2.size())) + ", " + str(int(ColHits3.size()));
-    sRecoObjects += "\n# Cluster from the hits: " + str(int(Clusters0.size())) + ", " + str(int(Clusters1.size())) + ", " + str(int(Clusters2.size())) + ", " + str(int(Clusters3.size()));
-    sRecoObjects += "\n# Tracks (" + fTrackLabel + ") in full geometry: " + str(TrackNum);
+    if (fLogInfo)
+    {
+      sRecoObjects += "\n# OpHits (" + fOpHitLabel + ") in full geometry: " + str(OpHitNum);
+      sRecoObjects += "\n# OpFlashes (" + fOpFlashLabel + ") in full geometry: " + str(OpFlashNum);
+      sRecoObjects += "\n# Hits (" + fHitLabel + ") in each view: " + str(int(ColHits0.size())) + ", " + str(int(ColHits1.size())) + ", " + str(int(ColHits2.size())) + ", " + str(int(ColHits3.size()));
+      sRecoObjects += "\n# Cluster from the hits: " + str(int(Clusters0.size())) + ", " + str(int(Clusters1.size())) + ", " + str(int(Clusters2.size())) + ", " + str(int(Clusters3.size()));
+      sRecoObjects += "\n# Tracks (" + fTrackLabel + ") in full geometry: " + str(TrackNum);
+    }
     PrintInColor(sRecoObjects, GetColor("cyan"));
 
     //------------------------------------------------------------ First complete cluster analysis ------------------------------------------------------------------//
@@ -1001,6 +1017,20 @@ namespace solar
     std::vector<float> MVecInd0RecoY = {}, MVecInd1RecoY = {}, MVecRecY = {}, MVecRecZ = {};
     std::vector<float> MVecFracE = {}, MVecFracGa = {}, MVecFracNe = {}, MVecFracRest = {}, MVecPur = {};
 
+    // --- Index the induction clusters by time so that each collection cluster only visits the candidates inside its matching window
+    std::vector<std::vector<int>> IndSortedIdx = {{}, {}};
+    std::vector<std::vector<float>> IndSortedT = {{}, {}};
+    std::vector<int> MatchCandidates = {};
+    for (int idx = 0; idx < 2; idx++)
+    {
+      for (int jj = 0; jj < int(ClT[idx].size()); jj++)
+      {
+        if (!std::isnan(ClT[idx][jj])) { IndSortedIdx[idx].push_back(jj); }
+      }
+      std::stable_sort(IndSortedIdx[idx].begin(), IndSortedIdx[idx].end(), [&ClT, idx](int a, int b) { return ClT[idx][a] < ClT[idx][b]; });
+      for (int jj : IndSortedIdx[idx]) { IndSortedT[idx].push_back(ClT[idx][jj]); }
+    }
+
     for (int ii = 0; ii < int(AllPlaneClusters[2].size()); ii++)
     {
       bool match = false;
@@ -1012,16 +1042,9 @@ namespace solar
       {
         if (!AllPlaneClusters[0].empty())
         {
-          for (int jj = 0; jj < int(AllPlaneClusters[0].size()); jj++)
+          FindMatchCandidates(ClT[2][ii], ClNHits[2][ii], ClCharge[2][ii], IndSortedT[0], IndSortedIdx[0], ClNHits[0], ClCharge[0], MatchCandidates);
+          for (int jj : MatchCandidates)
           {
-            if (ClNHits[0][jj] < (1 - fClusterMatchNHit) * ClNHits[2][ii] || ClNHits[0][jj] > (1 + fClusterMatchNHit) * ClNHits[2][ii])
-            {
-              continue;
-            }
-            if (ClCharge[0][jj] < (1 - fClusterMatchCharge) * ClCharge[2][ii] || ClCharge[0][jj] > (1 + fClusterMatchCharge) * ClCharge[2][ii])
-            {
-              continue;
-            }
             if (abs(ClT[2][ii] - ClT[0][jj]) < fClusterMatchTime && abs(fClusterInd0MatchTime - abs(ClT[2][ii] - ClT[0][jj])) < abs(fClusterInd0MatchTime - ind0clustdT))
             {
               ind0clustY = ClY[0][jj] + (ClZ[2][ii] - ClZ[0][jj]) / (Cldzdy[0][jj]);
@@ -1041,16 +1064,9 @@ namespace solar
         }
         if (!AllPlaneClusters[1].empty())
         {
-          for (int zz = 0; zz < int(AllPlaneClusters[1].size()); zz++)
+          FindMatchCandidates(ClT[2][ii], ClNHits[2][ii], ClCharge[2][ii], IndSortedT[1], IndSortedIdx[1], ClNHits[1], ClCharge[1], MatchCandidates);
+          for (int zz : MatchCandidates)
           {
-            if (ClNHits[1][zz] < (1 - fClusterMatchNHit) * ClNHits[2][ii] || ClNHits[1][zz] > (1 + fClusterMatchNHit) * ClNHits[2][ii])
-            {
-              continue;
-            }
-            if (ClCharge[1][zz] < (1 - fClusterMatchCharge) * ClCharge[2][ii] || ClCharge[1][zz] > (1 + fClusterMatchCharge) * ClCharge[2][ii])
-            {
-              continue;
-            }
             if (abs(ClT[2][ii] - ClT[1][zz]) < fClusterMatchTime && abs(fClusterInd1MatchTime - abs(ClT[2][ii] - ClT[1][zz])) < abs(fClusterInd1MatchTime - ind1clustdT))
             {
               ind1clustY = ClY[1][zz] + (ClZ[2][ii] - ClZ[1][zz]) / (Cldzdy[1][zz]);
@@ -1148,6 +1164,47 @@ namespace solar
     }   // Loop over collection plane clusters
 
     //-------------------------------------------------------------------- Cluster Tree Export -------------------------------------------------------------------------//
+    // --- Bucket the matched clusters in a uniform grid of the drift-corrected (Y, Z, X) space with cells larger than fAdjClusterRad,
+    // so that the adjacent clusters of each primary are searched only in the neighbouring cells. Clusters with non-finite
+    // coordinates are kept aside and tested against every primary, as the radius cut never rejected them.
+    bool UseClusterGrid = (fGeometry == "HD" || fGeometry == "VD") && fAdjClusterRad > 0;
+    float ClusterGridCell = fAdjClusterRad + 1;
+    float ClusterDriftScale = (fGeometry == "VD") ? float(fDetectorSizeX) / (fDetectorDriftTime / 2) : float(fDetectorSizeX) / fDetectorDriftTime;
+    std::map<std::array<long, 3>, std::vector<int>> ClusterGrid;
+    std::vector<std::array<long, 3>> ClusterCell(MVecNHit.size());
+    std::vector<bool> ClusterBinned(MVecNHit.size(), false);
+    std::vector<int> UnbinnedClusters = {}, AdjCandidates = {};
+    if (UseClusterGrid)
+    {
+      for (int j = 0; j < int(MVecNHit.size()); j++)
+      {
+        float Coord[3] = {MVecRecY[j], MVecRecZ[j], MVecTime[j] * ClusterDriftScale};
+        ClusterBinned[j] = true;
+        for (int k = 0; k < 3; k++)
+        {
+          if (!std::isfinite(Coord[k] / ClusterGridCell) || std::abs(Coord[k] / ClusterGridCell) > 1e9)
+          {
+            ClusterBinned[j] = false;
+            break;
+          }
+          ClusterCell[j][k] = long(std::floor(Coord[k] / ClusterGridCell));
+        }
+        if (ClusterBinned[j]) { ClusterGrid[ClusterCell[j]].push_back(j); }
+        else { UnbinnedClusters.push_back(j); }
+      }
+    }
+
+    // --- Sort the flashes by time so that each primary only visits the flashes inside [MTime - fAdjOpFlashTime, MTime]
+    std::vector<int> FlashSortedIdx = {}, UntimedFlashes = {}, AdjFlashCandidates = {};
+    std::vector<float> FlashSortedT = {};
+    for (int j = 0; j < int(OpFlashT.size()); j++)
+    {
+      if (std::isnan(OpFlashT[j])) { UntimedFlashes.push_back(j); }
+      else { FlashSortedIdx.push_back(j); }
+    }
+    std::stable_sort(FlashSortedIdx.begin(), FlashSortedIdx.end(), [this](int a, int b) { return OpFlashT[a] < OpFlashT[b]; });
+    for (int j : FlashSortedIdx) { FlashSortedT.push_back(OpFlashT[j]); }
+
     // Loop over matched clusters and export to tree if number of hits is above threshold
     for (int i = 0; i < int(MVecNHit.size()); i++)
     {
@@ -1161,43 +1218,67 @@ namespace solar
       if (MVecNHit[i] > fClusterPreselectionNHit && (MVecInd0NHits[i] > fClusterPreselectionNHit || MVecInd1NHits[i] > fClusterPreselectionNHit))
       {
         MPrimary = true;
-        MAdjClTime = {};
-        MAdjClCharge = {};
-        MAdjClInd0Charge = {};
-        MAdjClInd1Charge = {};
-        MAdjClMaxCharge = {};
-        MAdjClInd0MaxCharge = {};
-        MAdjClInd1MaxCharge = {};
-        MAdjClNHit = {};
-        MAdjClInd0NHit = {};
-        MAdjClInd1NHit = {};
-        MAdjClRecoY = {};
-        MAdjClRecoZ = {};
-        MAdjClR = {};
-        MAdjClPur = {};
-        MAdjClGen = {};
-        MAdjClMainID = {};
-        MAdjClMainPDG = {};
-        MAdjClMainE = {};
-        MAdjClMainX = {};
-        MAdjClMainY = {};
-        MAdjClMainZ = {};
-        MAdjClEndX = {};
-        MAdjClEndY = {};
-        MAdjClEndZ = {};
-        MAdjFlashTime = {};
-        MAdjFlashPE = {};
-        MAdjFlashNHit = {};
-        MAdjFlashMaxPE = {};
-        MAdjFlashRecoX = {};
-        MAdjFlashRecoY = {};
-        MAdjFlashRecoZ = {};
-        MAdjFlashR = {};
-        MAdjFlashPur = {};
+        MAdjClTime.clear();
+        MAdjClCharge.clear();
+        MAdjClInd0Charge.clear();
+        MAdjClInd1Charge.clear();
+        MAdjClMaxCharge.clear();
+        MAdjClInd0MaxCharge.clear();
+        MAdjClInd1MaxCharge.clear();
+        MAdjClNHit.clear();
+        MAdjClInd0NHit.clear();
+        MAdjClInd1NHit.clear();
+        MAdjClRecoY.clear();
+        MAdjClRecoZ.clear();
+        MAdjClR.clear();
+        MAdjClPur.clear();
+        MAdjClGen.clear();
+        MAdjClMainID.clear();
+        MAdjClMainPDG.clear();
+        MAdjClMainE.clear();
+        MAdjClMainX.clear();
+        MAdjClMainY.clear();
+        MAdjClMainZ.clear();
+        MAdjClEndX.clear();
+        MAdjClEndY.clear();
+        MAdjClEndZ.clear();
+        MAdjFlashTime.clear();
+        MAdjFlashPE.clear();
+        MAdjFlashNHit.clear();
+        MAdjFlashMaxPE.clear();
+        MAdjFlashRecoX.clear();
+        MAdjFlashRecoY.clear();
+        MAdjFlashRecoZ.clear();
+        MAdjFlashR.clear();
+        MAdjFlashPur.clear();
         MTrackStart = {-1e6, -1e6, -1e6};
         MTrackEnd = {-1e6, -1e6, -1e6};
 
-        for (int j = 0; j < int(MVecNHit.size()); j++)
+        // --- Collect the candidate adjacent clusters from the grid, in their original order
+        AdjCandidates.clear();
+        if (UseClusterGrid && ClusterBinned[i])
+        {
+          for (long dy = -1; dy <= 1; dy++)
+          {
+            for (long dz = -1; dz <= 1; dz++)
+            {
+              for (long dx = -1; dx <= 1; dx++)
+              {
+                auto Cell = ClusterGrid.find({ClusterCell[i][0] + dy, ClusterCell[i][1] + dz, ClusterCell[i][2] + dx});
+                if (Cell == ClusterGrid.end()) { continue; }
+                AdjCandidates.insert(AdjCandidates.end(), Cell->second.begin(), Cell->second.end());
+              }
+            }
+          }
+          AdjCandidates.insert(AdjCandidates.end(), UnbinnedClusters.begin(), UnbinnedClusters.end());
+          std::sort(AdjCandidates.begin(), AdjCandidates.end());
+        }
+        else
+        {
+          for (int j = 0; j < int(MVecNHit.size()); j++) { AdjCandidates.push_back(j); }
+        }
+
+        for (int j : AdjCandidates)
         {
           if (j == i)
           {
@@ -1237,10 +1318,7 @@ namespace solar
           MAdjClMainID.push_back(MVecMainID[j]);
 
           // If mother exists add the mother information
-          const simb::MCParticle *MAdjClTruth;
-          int TerminalOutput = supress_stdout();
-          MAdjClTruth = pi_serv->TrackIdToParticle_P(MVecMainID[j]);
-          resume_stdout(TerminalOutput);
+          const simb::MCParticle *MAdjClTruth = TrackIdToParticle(MVecMainID[j]);
           if (MAdjClTruth == 0)
           {
             MAdjClMainPDG.push_back(0);
@@ -1273,7 +1351,7 @@ namespace solar
         {
           sResultColor = "yellow";
         }
-        sClusterReco += "*** Matched preselection cluster: \n - Primary  " + str(MPrimary) + " Gen " + str(MVecGen[i]) + " Purity " + str(MVecPur[i]) + " Hits " + str(MVecNHit[i]) + "\n - RecoY, RecoZ (" + str(MVecRecY[i]) + ", " + str(MVecRecZ[i]) + ") Time " + str(MVecTime[i]) + "\n";
+        if (fLogInfo) sClusterReco += "*** Matched preselection cluster: \n - Primary  " + str(MPrimary) + " Gen " + str(MVecGen[i]) + " Purity " + str(MVecPur[i]) + " Hits " + str(MVecNHit[i]) + "\n - RecoY, RecoZ (" + str(MVecRecY[i]) + ", " + str(MVecRecZ[i]) + ") Time " + str(MVecTime[i]) + "\n";
 
         if (MPrimary){
           TVector3 ThisClVertex = {0, MVecRecY[i], MVecRecZ[i]};
@@ -1289,14 +1367,25 @@ namespace solar
             MTrackStart = {trk.Start().X(), trk.Start().Y(), trk.Start().Z()};
             MTrackEnd = {trk.End().X(), trk.End().Y(), trk.End().Z()};
             MTrackChi2 = trk.Chi2();
-            sClusterReco += "*** Matched pmtrack: \n";
-            sClusterReco += " - Track has start (" + str(trk.Start().X()) + ", " + str(trk.Start().Y()) + ", " + str(trk.Start().Z()) + ")\n";
-            sClusterReco += " - Track has end   (" + str(trk.End().X()) + ", " + str(trk.End().Y()) + ", " + str(trk.End().Z()) + ")\n";
+            if (fLogInfo)
+            {
+              sClusterReco += "*** Matched pmtrack: \n";
+              sClusterReco += " - Track has start (" + str(trk.Start().X()) + ", " + str(trk.Start().Y()) + ", " + str(trk.Start().Z()) + ")\n";
+              sClusterReco += " - Track has end   (" + str(trk.End().X()) + ", " + str(trk.End().Y()) + ", " + str(trk.End().Z()) + ")\n";
+            }
             TrackMatch = true;  
           }; // Loop over tracks
         };
 
-        for (int j = 0; j < int(OpFlashPE.size()); j++)
+        // --- Collect the candidate adjacent flashes from the time-sorted index (widened by one tick), in their original order
+        AdjFlashCandidates.clear();
+        auto FlashBegin = std::lower_bound(FlashSortedT.begin(), FlashSortedT.end(), MVecTime[i] - fAdjOpFlashTime - 1);
+        auto FlashEnd = std::upper_bound(FlashBegin, FlashSortedT.end(), MVecTime[i] + 1);
+        for (auto it = FlashBegin; it != FlashEnd; ++it) { AdjFlashCandidates.push_back(FlashSortedIdx[it - FlashSortedT.begin()]); }
+        AdjFlashCandidates.insert(AdjFlashCandidates.end(), UntimedFlashes.begin(), UntimedFlashes.end());
+        std::sort(AdjFlashCandidates.begin(), AdjFlashCandidates.end());
+
+        for (int j : AdjFlashCandidates)
         {
           if ((MVecTime[i] - OpFlashT[j]) < 0)
           {
@@ -1357,10 +1446,7 @@ namespace solar
         MMainID = MVecMainID[i];
 
         // If mother exists add the mother information
-        const simb::MCParticle *MClTruth;
-        int TerminalOutput = supress_stdout();
-        MClTruth = pi_serv->TrackIdToParticle_P(MVecMainID[i]);
-        resume_stdout(TerminalOutput);
+        const simb::MCParticle *MClTruth = TrackIdToParticle(MVecMainID[i]);
         if (MClTruth == 0)
         {
           MMainVertex = {-1e6, -1e6, -1e6};
@@ -1388,10 +1474,7 @@ namespace solar
           MMainK = MMainE - 1e3*MClTruth->Mass();
           MMainT = MClTruth->T();
           // If exists add the parent information
-          const simb::MCParticle *MClParentTruth;
-          int TerminalOutput = supress_stdout();
-          MClParentTruth = pi_serv->TrackIdToParticle_P(MClTruth->Mother());
-          resume_stdout(TerminalOutput);
+          const simb::MCParticle *MClParentTruth = TrackIdToParticle(MClTruth->Mother());
           if (MClParentTruth == 0)
           {
             MMainParentVertex = {-1e6, -1e6, -1e6};
@@ -1496,6 +1579,34 @@ namespace solar
     return;
   }
 
+  //......................................................
+  // This function collects the induction clusters that can be matched to a collection cluster.
+  // The time-sorted index is binary searched for the matching window, widened by one tick so that
+  // the exact time cut is still applied by the caller, and the NHit and charge cuts are applied on
+  // the per-plane cluster arrays. Candidates are returned in their original order to keep the
+  // tie-breaking of the sequential matching unchanged.
+  void SolarNuAna::FindMatchCandidates(float ColTime, int ColNHits, float ColCharge, const std::vector<float> &SortedT, const std::vector<int> &SortedIdx, const std::vector<int> &IndNHits, const std::vector<float> &IndCharge, std::vector<int> &Candidates)
+  {
+    Candidates.clear();
+    auto Begin = std::lower_bound(SortedT.begin(), SortedT.end(), ColTime - fClusterMatchTime - 1);
+    auto End = std::upper_bound(Begin, SortedT.end(), ColTime + fClusterMatchTime + 1);
+    for (auto it = Begin; it != End; ++it)
+    {
+      int jj = SortedIdx[it - SortedT.begin()];
+      if (IndNHits[jj] < (1 - fClusterMatchNHit) * ColNHits || IndNHits[jj] > (1 + fClusterMatchNHit) * ColNHits)
+      {
+        continue;
+      }
+      if (IndCharge[jj] < (1 - fClusterMatchCharge) * ColCharge || IndCharge[jj] > (1 + fClusterMatchCharge) * ColCharge)
+      {
+        continue;
+      }
+      Candidates.push_back(jj);
+    }
+    std::sort(Candidates.begin(), Candidates.end());
+    return;
+  }
+
   //......................................................
   // This function checks if a given TrackID is in a given map
   bool SolarNuAna::InMyMap(int TrID, std::map<int, simb::MCParticle> ParMap)
@@ -1523,15 +1634,30 @@ namespace solar
   }
 
 
+  //......................................................
+  // This function checks if a message of the given level would reach any destination
+  bool SolarNuAna::IsLogEnabled(std::string Type)
+  {
+    if (Type == "Info")
+      return mf::isInfoEnabled();
+    if (Type == "Debug" || Type == "Degub")
+      return mf::isDebugEnabled();
+    return true;
+  }
+
   //......................................................
   // This function creates a terminal color printout
   void SolarNuAna::PrintInColor(std::string MyString, int Color, std::string Type)
   {
+    if (!IsLogEnabled(Type))
+    {
+      return;
+    }
     if (Type == "Info")
     {
       mf::LogInfo("SolarNuAna") << "\033[" << Color << "m" << MyString << "\033[0m";
     }
-    if (Type == "Degub")
+    if (Type == "Debug" || Type == "Degub")
     {
       mf::LogDebug("SolarNuAna") << "\033[" << Color << "m" << MyString << "\033[0m";
     }
@@ -1633,24 +1759,15 @@ namespace solar
     return ss.str();
   }
 
-  int SolarNuAna::supress_stdout()
-  {
-    std::fflush(stdout);
-
-    int ret = dup(1);
-    int nullfd = open("/dev/null", O_WRONLY);
-    // check nullfd for error omitted
-    dup2(nullfd, 1);
-    close(nullfd);
-
-    return ret;
-  }
-
-  void SolarNuAna::resume_stdout(int fd)
+  //......................................................
+  // Look the TrackID up in the particle list directly: TrackIdToParticle_P prints a warning for every ID that is not there
+  const simb::MCParticle *SolarNuAna::TrackIdToParticle(int TrackID)
   {
-    std::fflush(stdout);
-    dup2(fd, 1);
-    close(fd);
+    const sim::ParticleList &PartList = pi_serv->ParticleList();
+    sim::ParticleList::const_iterator It = PartList.find(TrackID);
+    if (It == PartList.end())
+      return 0;
+    return It->second;
   }
 } // namespace solar
 DEFINE_ART_MODULE(solar::SolarNuAna)
\ No newline at end of file
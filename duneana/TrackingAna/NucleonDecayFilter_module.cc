@@ -22,6 +22,7 @@
 #include "art/Framework/Principal/Event.h" 
 #include "art/Framework/Principal/Handle.h"
 #include "fhiclcpp/ParameterSet.h"
+#include "canvas/Utilities/Exception.h"
 #include "art_root_io/TFileService.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
@@ -35,7 +36,8 @@
 #include "TTree.h"
 
 //standard library includes
-#include <map>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -57,12 +59,26 @@ namespace filt{
     void beginJob() ;
 
   private:
+    // Types of particle the energy deposits are attributed to
+    enum class PartType : signed char { Unknown = -1, None, Muon, Pion, Pi0, Kaon, Elec };
+    // The interesting particle a TrackID descends from (itself included)
+    struct Ancestor_t {
+      PartType type = PartType::Unknown;
+      int trackID = 0;
+    };
+
     // My functions
-    void FillVars( std::vector<int> &TrackIDVec, int &numParts, int ThisID );
+    PartType Classify( const simb::MCParticle& part ) const;
+    Ancestor_t FindAncestor( int trackID );
+    int& Counter( PartType type );
 
     // Global variables
     double ActiveBounds[6]; // Cryostat boundaries ( neg x, pos x, neg y, pos y, neg z, pos z )
-    std::map<int, const simb::MCParticle*> truthmap; // A map of the truth particles.
+    // Per event tables, indexed by TrackID
+    std::vector<const simb::MCParticle*> fParticles; // The truth particles.
+    std::vector<Ancestor_t> fAncestors; // Ancestor of each particle, resolved once.
+    std::vector<bool> fCounted; // Whether an ancestor was already counted.
+    std::vector<int> fChain; // Scratch space for the mother chain walk.
 
     // Handles
     art::ServiceHandle<geo::Geometry> geom;
@@ -111,19 +127,23 @@ namespace filt{
     // Any providers I need.
     auto const* geo = lar::providerFrom<geo::Geometry>();
     
-    // Make a map of MCParticles which I can access later.
+    // Make a table of MCParticles, indexed by TrackID, which I can access later.
     auto truth = e.getHandle<std::vector<simb::MCParticle> >("largeant");
-    truthmap.clear();
-    for (size_t i=0; i<truth->size(); i++)
-      truthmap[truth->at(i).TrackId()]=&((*truth)[i]);
-    //std::cout << "The primary muon in this event had an energy of " << truthmap[1]->E() << std::endl;
+    int MaxTrackID = 0;
+    for (auto const& part:*truth)
+      MaxTrackID = std::max(MaxTrackID, part.TrackId());
+    fParticles.assign(MaxTrackID+1, nullptr);
+    for (auto const& part:*truth)
+      if (part.TrackId() >= 0) fParticles[part.TrackId()] = &part;
+    fAncestors.assign(fParticles.size(), Ancestor_t{});
+    fCounted.assign(fParticles.size(), false);
 
     // Get a vector of sim channels.
     auto simchannels = e.getHandle<std::vector<sim::SimChannel> >("largeant");
 
-    // Make vectors to hold all of my particle TrackIDs
-    std::vector<int> MuonVec, PionVec, Pi0Vec, KaonVec, ElecVec;
-    
+    // ------ Once a count exceeds MaxPart the event fails, so I can stop looking ------
+    bool Decided = false;
+
     // ------ Now loop through all of my hits ------
     for (auto const& simchannel:*simchannels) {
     // ------ Only want to look at collection plane hits ------
@@ -133,45 +153,25 @@ namespace filt{
 	auto const& idevec=tdcide.second;
 	// ------ Look at each individual IDE ------
 	for (auto const& ide:idevec) {
-	  int ideTrackID = ide.trackID;
+	  // ------ Which interesting particle (if any) does this IDE belong to? ------
+	  Ancestor_t const ancestor = FindAncestor( ide.trackID );
+	  // ------ Nothing to count, or already counted: no need to look for the TPC ------
+	  if (ancestor.type == PartType::None || fCounted[ancestor.trackID]) continue;
 	  // ------ Is the hit in a TPC? ------
           geo::TPCID tpcid=geo->FindTPCAtPosition(geo::Point_t{ide.x, ide.y, ide.z});
 	  if (!(geo->HasTPC(tpcid)) ) {
 	    //std::cout << "Outside the Active volume I found at the top!" << std::endl;
 	    continue;
 	  }
-	  // ------ Now to work out which particles in particular I want to save more information about... ------
-	  // ----------------- I want to write out the IDE to the relevant parent particle type -----------------
-	  // ------- This means looping back through the IDE's parents until I find an interesting TrackID ------
-	  bool WrittenOut = false;
-	  while ( ideTrackID != 0 && !WrittenOut ) {
-	    const simb::MCParticle& part=*( truthmap[ abs(ideTrackID) ] );
-	    int PdgCode=part.PdgCode();
-	    WrittenOut = true; // If one of my particles don't want to go further back.
-	    // ========== Muons ==========
-	    if      ( (PdgCode == -13  || PdgCode == 13)  ) 
-	      FillVars( MuonVec, nMuon, ideTrackID );
-	    // ========== Pions ==========
-	    else if ( (PdgCode == -211 || PdgCode == 211) && part.Process() != "pi+Inelastic" && part.Process() != "pi-Inelastic" ) 
-	      FillVars( PionVec, nPion, ideTrackID );
-	    // ========== Pi0s  ==========
-	    else if ( PdgCode == 111  )
-	      FillVars( Pi0Vec , nPi0 , ideTrackID );
-	    // ========== Kaons ===========
-	    else if ( (PdgCode == 321 || PdgCode == -321) && part.Process() != "kaon+Inelastic" && part.Process() != "kaon-Inelastic" ) 
-	      FillVars( KaonVec, nKaon, ideTrackID );
-	    // ========== Elecs ===========
-	    else if ( (PdgCode == -11 || PdgCode == 11)  )
-	      FillVars( ElecVec, nElec, ideTrackID );
-	    // ========== If still not one of my intersting particles I need to find this particles parent ==========
-	    else {
-	      ideTrackID = part.Mother();
-	      PdgCode = truthmap[ abs(ideTrackID) ]->PdgCode();
-	      WrittenOut = false; // If not one of my particles change back to false.
-	    } // If not one of chosen particles.
-	  } // While loop
+	  fCounted[ancestor.trackID] = true;
+	  if (++Counter(ancestor.type) > MaxPart) {
+	    Decided = true;
+	    break;
+	  }
 	} // Each IDE ( ide:idevec )
+	if (Decided) break;
       } // IDE vector for SimChannel ( tdcide:simcahnnel.TPCIDEMap() )
+      if (Decided) break;
     } // Loop through simchannels
     /*
     std::cout << "Looking at Run " << Run << " SubRun " << SubRun << " Event " << Event
@@ -222,13 +222,62 @@ namespace filt{
     MyOutTree->Branch( "nKaon", &nKaon , "nKaon/I"  );
     MyOutTree->Branch( "nElec", &nElec , "nElec/I"  );
   }
-  // *********************************** Fill Variable ***********************************
-  void NucleonDecayFilter::FillVars( std::vector<int> &TrackIDVec, int &numParts, int ThisID ) {
-    std::vector<int>::iterator it=std::find( TrackIDVec.begin(), TrackIDVec.end(), abs(ThisID) );
-    if ( it==TrackIDVec.end() ) {
-      TrackIDVec.push_back ( abs(ThisID) ); // Push back this particle type IDVec
-      ++numParts;
+  // ********************************** Classify Particle **********************************
+  NucleonDecayFilter::PartType NucleonDecayFilter::Classify( const simb::MCParticle& part ) const {
+    int PdgCode=part.PdgCode();
+    // ========== Muons ==========
+    if      ( (PdgCode == -13  || PdgCode == 13)  )
+      return PartType::Muon;
+    // ========== Pions ==========
+    else if ( (PdgCode == -211 || PdgCode == 211) && part.Process() != "pi+Inelastic" && part.Process() != "pi-Inelastic" )
+      return PartType::Pion;
+    // ========== Pi0s  ==========
+    else if ( PdgCode == 111  )
+      return PartType::Pi0;
+    // ========== Kaons ===========
+    else if ( (PdgCode == 321 || PdgCode == -321) && part.Process() != "kaon+Inelastic" && part.Process() != "kaon-Inelastic" )
+      return PartType::Kaon;
+    // ========== Elecs ===========
+    else if ( (PdgCode == -11 || PdgCode == 11)  )
+      return PartType::Elec;
+    // ========== Not one of my interesting particles, need to look at its parent ==========
+    return PartType::None;
+  }
+  // *********************************** Find Ancestor ***********************************
+  NucleonDecayFilter::Ancestor_t NucleonDecayFilter::FindAncestor( int trackID ) {
+    // ------ Walk back through the parents until an interesting particle, or one already ------
+    // ------ resolved, is found; then remember the answer for the whole chain.          ------
+    Ancestor_t Result{ PartType::None, 0 };
+    int ThisID = abs(trackID);
+    while ( ThisID != 0 ) {
+      if ( ThisID >= (int) fParticles.size() || !fParticles[ThisID] ) break; // Not in the particle list.
+      if ( fAncestors[ThisID].type != PartType::Unknown ) {
+	Result = fAncestors[ThisID];
+	break;
+      }
+      fChain.push_back( ThisID );
+      PartType const Type = Classify( *fParticles[ThisID] );
+      if ( Type != PartType::None ) {
+	Result = { Type, ThisID };
+	break;
+      }
+      ThisID = abs( fParticles[ThisID]->Mother() );
+    }
+    for (int ChainID:fChain) fAncestors[ChainID] = Result;
+    fChain.clear();
+    return Result;
+  }
+  // ************************************ Get Counter ************************************
+  int& NucleonDecayFilter::Counter( PartType type ) {
+    switch ( type ) {
+      case PartType::Muon: return nMuon;
+      case PartType::Pion: return nPion;
+      case PartType::Pi0:  return nPi0;
+      case PartType::Kaon: return nKaon;
+      case PartType::Elec: return nElec;
+      default: break;
     }
+    throw art::Exception(art::errors::LogicError) << "No counter for particle type " << int(type);
   }
   // *********************************** Define Module ***********************************
   DEFINE_ART_MODULE(NucleonDecayFilter)
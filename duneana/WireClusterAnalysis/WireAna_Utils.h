@@ -2,8 +2,12 @@
 #define WIREANA_UTILS_H
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
-#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 #define UNCLASSIFIED -1
 #define CORE_POINT 1
@@ -66,11 +70,13 @@ namespace wireana{
     }
   };
 
+  //! A signal range of a wire. The samples are not copied: the roi refers to the
+  //! range by its index in the wire's SignalROI and caches the derived quantities.
   struct roi{
-    roi( const art::Ptr<recob::Wire> &wire, recob::Wire::RegionsOfInterest_t::datarange_t r)
+    roi( const art::Ptr<recob::Wire> &wire, size_t range_index )
       :wire(wire)
     {
-      updateroi(wire, r);
+      updateroi(wire, range_index);
     }
     //roi( const roi &r )
     //{
@@ -79,7 +85,7 @@ namespace wireana{
     roi(){};
 
     const art::Ptr<recob::Wire> wire;
-    recob::Wire::RegionsOfInterest_t::datarange_t range;
+    size_t range_index=0;
     int channel=-1;
     int begin_index=-1;
     int end_index=-1;
@@ -97,9 +103,15 @@ namespace wireana{
     double true_electron_deposit = 0;
     double tdc_hit_fraction = 0;
 
-    void updateroi( const art::Ptr<recob::Wire> &wire, recob::Wire::RegionsOfInterest_t::datarange_t r)
+    const recob::Wire::RegionsOfInterest_t::datarange_t &Range() const
+    {
+      return this->wire->SignalROI().get_ranges()[this->range_index];
+    }
+
+    void updateroi( const art::Ptr<recob::Wire> &wire, size_t range_index )
     {
-      this->range = r;
+      this->range_index = range_index;
+      const auto &r = wire->SignalROI().get_ranges()[range_index];
       this->channel = wire->Channel();
       this->begin_index = r.begin_index();
       this->end_index = r.end_index();
@@ -110,19 +122,21 @@ namespace wireana{
       this->abs_centroid = this->Centroid(true);
     }
 
-    double Sum(bool useabs=false)
+    double Sum(bool useabs=false) const
     {
+      const auto &range = this->Range();
       double ret=0;
-      for( auto it = this->range.begin(); it!=this->range.end(); ++it ) ret+= (useabs)? abs(*it):*it;
+      for( auto it = range.begin(); it!=range.end(); ++it ) ret+= (useabs)? abs(*it):*it;
       return ret;
     }
-    double Centroid(bool useabs=false)
+    double Centroid(bool useabs=false) const
     {
+      const auto &range = this->Range();
       double denum = 0;
       double num = 0;
-      for( size_t i = this->range.begin_index(); i != this->range.end_index(); i++ )
+      for( size_t i = range.begin_index(); i != range.end_index(); i++ )
       {
-        double v = this->range[i];
+        double v = range[i];
         if (useabs) v = abs(v);
         denum+=v;
         num+=(i*v);
@@ -135,7 +149,7 @@ namespace wireana{
   };
   bool operator == ( const roi &lhs, const roi &rhs )
   {
-    return ( lhs.wire == rhs.wire &&  lhs.range == rhs.range && lhs.hasTrueSignal == rhs.hasTrueSignal );
+    return ( lhs.wire == rhs.wire &&  lhs.range_index == rhs.range_index && lhs.hasTrueSignal == rhs.hasTrueSignal );
   }
 
 
@@ -167,7 +181,10 @@ namespace wireana{
     int n_nucleus = 0;
     int n_meson = 0;
 
-    std::vector< roi > ROIs;
+    //! The ROIs are stored once per event in the plane/view roi vector (the arena);
+    //! a cluster only keeps their indices into it.
+    std::vector< roi > *arena = nullptr;
+    std::vector< int > roiIndices;
     std::vector< std::pair< int, std::pair<float,float> > > pdg_energy_list;
     std::vector< std::pair< int, std::pair<float,float> > > trkID_sum; 
     std::string label;
@@ -178,9 +195,18 @@ namespace wireana{
     int width_ticks;
 
 
-    void AddROI( roi &roi, int planeid )
+    size_t NROIs() const { return roiIndices.size(); }
+    roi &ROI( size_t i ) const { return (*arena)[ roiIndices[i] ]; }
+
+    void AddROI( std::vector< wireana::roi > &rois, int index, int planeid )
     {
-      if(ROIs.size() == 0)
+      if( this->arena && this->arena != &rois )
+      {
+        std::cout<<"ROI is not in the ROICluster arena!"<<std::endl;
+        return;
+      }
+      const wireana::roi &roi = rois[index];
+      if(roiIndices.size() == 0)
       {
         this->nWires=1;
         this->clusterID=roi.clusterID;
@@ -204,7 +230,8 @@ namespace wireana{
         begin_index = (roi.begin_index < begin_index)? roi.begin_index : begin_index;
         end_index = (roi.end_index > end_index)? roi.end_index : end_index;
       }
-      ROIs.push_back(roi);
+      this->arena = &rois;
+      roiIndices.push_back(index);
       // centroid = Sum( index*energy )/sum(energy)
       this->abs_centroidChannel*= this->abs_sum;
       this->abs_centroidChannel+= roi.channel * roi.abs_sum;
@@ -228,18 +255,19 @@ namespace wireana{
     double TotalSignal(bool useabs=false)
     {
       double ret = 0;
-      for( auto &roi : this->ROIs ) ret+=roi.Sum(useabs);
+      for( size_t i = 0; i < NROIs(); i++ ) ret+=ROI(i).Sum(useabs);
       return ret;
     }
-    double GetNROIS(){ return this->ROIs.size(); }
+    double GetNROIS(){ return this->NROIs(); }
     int GetWidthTick(){ return (this->end_index - this->begin_index + 1);}
     int GetWidthChannel(){ return (this->channel_max- this->channel_min + 1);}
 
     std::vector< art::Ptr<recob::Wire> > GetWires()
     {
       std::vector< art::Ptr<recob::Wire> > ret;
-      for( auto &roi: this->ROIs ) 
+      for( size_t i = 0; i < NROIs(); i++ )
       {
+        const auto &roi = ROI(i);
         if( std::find( ret.begin(), ret.end(), roi.wire ) == ret.end() )
         {
           ret.push_back( roi.wire );
@@ -258,8 +286,9 @@ namespace wireana{
       c0=this->abs_centroidChannel - channel_width/2.;
       t0=this->abs_centroidIndex - tick_width/2.;
 
-      for( auto& roi : this->ROIs )
+      for( size_t i = 0; i < NROIs(); i++ )
       {
+        const auto &roi = ROI(i);
         int c = roi.channel - c0;
         for ( int index = roi.begin_index; index<=roi.end_index; ++index )
         {
@@ -318,7 +347,8 @@ namespace wireana{
         l.n_photon           ==      r.n_photon              &&
         l.n_nucleus          ==      r.n_nucleus             &&
         l.n_meson            ==      r.n_meson          &&
-        l.ROIs               ==      r.ROIs      );
+        l.arena              ==      r.arena                 &&
+        l.roiIndices         ==      r.roiIndices  );
   }
 
   struct matchedroicluster{
@@ -326,25 +356,25 @@ namespace wireana{
     {
       this->planeid = planeid;
       this->metric = metric;
-      clusters.push_back(u);
-      clusters.push_back(v);
-      clusters.push_back(z);
-      totalROIs = u.ROIs.size() + v.ROIs.size() + z.ROIs.size();
+      clusters.push_back(&u);
+      clusters.push_back(&v);
+      clusters.push_back(&z);
+      totalROIs = u.NROIs() + v.NROIs() + z.NROIs();
     }
     int planeid;
     double metric;
     int totalROIs;
-    //u=0, v=1, z=2
-    std::vector<roicluster> clusters;
+    //u=0, v=1, z=2, owned by the event's PlaneViewROIClusterMap
+    std::vector<roicluster*> clusters;
 
     unsigned int gencode()
     {
       std::set<unsigned int> labelset;
       for( auto &cluster:clusters )
       {
-        labelset.insert( cluster.label_code );
+        labelset.insert( cluster->label_code );
       }
-      if ( labelset.size() == 1 ) return clusters.front().label_code;
+      if ( labelset.size() == 1 ) return clusters.front()->label_code;
       return kMismatch;
     }
 
@@ -353,9 +383,9 @@ namespace wireana{
       bool matched = false;
       if(clusters.size()==3)
       {
-        std::string l0 = clusters[0].label;
-        std::string l1 = clusters[1].label;
-        std::string l2 = clusters[2].label;
+        std::string l0 = clusters[0]->label;
+        std::string l1 = clusters[1]->label;
+        std::string l2 = clusters[2]->label;
         matched=((l0==l1)&&(l1==l2));
       }
       return matched;
@@ -367,11 +397,11 @@ namespace wireana{
       {
         for( auto &cluster : clusters )
         {
-          if ( cluster.trkID_sum.size() == 0 ) return false;
+          if ( cluster->trkID_sum.size() == 0 ) return false;
         }
-        int l0 = clusters[0].trkID_sum.front().first;
-        int l1 = clusters[1].trkID_sum.front().first;
-        int l2 = clusters[2].trkID_sum.front().first;
+        int l0 = clusters[0]->trkID_sum.front().first;
+        int l1 = clusters[1]->trkID_sum.front().first;
+        int l2 = clusters[2]->trkID_sum.front().first;
         matched=((l0==l1)&&(l1==l2));
       }
       return matched;
@@ -390,6 +420,7 @@ namespace wireana{
 
 
   class WireAnaDBSCAN;
+  class WireCrossingTable;
   class ROIMatcher;
   class numpywriter;
 }
@@ -429,6 +460,18 @@ public:
     std::vector<wireana::roi> *m_ROIs;
     
 private:    
+    // ROIs of each channel sorted by begin_index, used to restrict the neighbour search
+    struct ChannelBucket{
+      std::vector<int> index;
+      std::vector<int> begin;
+      int maxWidth = 0;
+    };
+    void buildIndex();
+
+    std::map<int, ChannelBucket> m_channelIndex;
+    bool m_useIndex = false;
+    int m_channelWindow = 0;
+    int m_tickWindow = 0;
     unsigned int m_roiSize;
     unsigned int m_minPoints;
     float m_epsilon;
@@ -445,6 +488,7 @@ wireana::WireAnaDBSCAN::run()
   int clusterID = 1;
   std::vector<roi>::iterator iter;
   if (!m_ROIs) return -1;
+  buildIndex();
   for(iter = m_ROIs->begin(); iter != m_ROIs->end(); ++iter)
   {
     if ( iter->clusterID == UNCLASSIFIED )
@@ -459,20 +503,62 @@ wireana::WireAnaDBSCAN::run()
 }
 
 
+void
+wireana::WireAnaDBSCAN::buildIndex()
+{
+  // A neighbour within eps is at most eps/pitch channels and 2*eps/drift ticks away
+  // (one extra channel/tick covers the float rounding of calculateDistance)
+  m_channelIndex.clear();
+  m_useIndex = ( m_pitch > 0 && m_drift > 0 && m_epsilon >= 0
+      && m_epsilon/m_pitch < 1e6 && 2.*m_epsilon/m_drift < 1e6 );
+  if (!m_useIndex) return;
+  m_channelWindow = std::floor(m_epsilon/m_pitch) + 1;
+  m_tickWindow = std::floor(2.*m_epsilon/m_drift) + 1;
+
+  for( int i = 0; i < (int) m_ROIs->size(); i++ )
+  {
+    const roi &r = (*m_ROIs)[i];
+    ChannelBucket &bucket = m_channelIndex[r.channel];
+    bucket.index.push_back(i);
+    bucket.maxWidth = std::max( bucket.maxWidth, r.end_index - r.begin_index );
+  }
+  for( auto &cb : m_channelIndex )
+  {
+    ChannelBucket &bucket = cb.second;
+    std::stable_sort( bucket.index.begin(), bucket.index.end(), [this](int a, int b){ return (*m_ROIs)[a].begin_index < (*m_ROIs)[b].begin_index; } );
+    bucket.begin.resize( bucket.index.size() );
+    for( size_t i = 0; i < bucket.index.size(); i++ ) bucket.begin[i] = (*m_ROIs)[bucket.index[i]].begin_index;
+  }
+}
+
 std::vector<int> 
 wireana::WireAnaDBSCAN::calculateCluster(wireana::roi &r)
 {
-  int index = 0;
-  std::vector<wireana::roi>::iterator iter;
   std::vector<int> clusterIndex;
-  for( iter = m_ROIs->begin(); iter != m_ROIs->end(); ++iter)
+  if (!m_useIndex)
+  {
+    for( int index = 0; index < (int) m_ROIs->size(); index++ )
+    {
+      if ( calculateDistance(r, (*m_ROIs)[index], m_drift, m_pitch) <= m_epsilon ) clusterIndex.push_back(index);
+    }
+    return clusterIndex;
+  }
+
+  // Only ROIs on nearby channels whose tick range can come within the window are tested
+  auto itch = m_channelIndex.lower_bound( r.channel - m_channelWindow );
+  for( ; itch != m_channelIndex.end() && itch->first <= r.channel + m_channelWindow; ++itch )
   {
-    if ( calculateDistance(r, *iter, m_drift, m_pitch) <= m_epsilon )
+    const ChannelBucket &bucket = itch->second;
+    auto first = std::lower_bound( bucket.begin.begin(), bucket.begin.end(), r.begin_index - m_tickWindow - bucket.maxWidth );
+    auto last = std::upper_bound( first, bucket.begin.end(), r.end_index + m_tickWindow );
+    for( auto it = first; it != last; ++it )
     {
-      clusterIndex.push_back(index);
+      int index = bucket.index[it - bucket.begin.begin()];
+      if ( calculateDistance(r, (*m_ROIs)[index], m_drift, m_pitch) <= m_epsilon ) clusterIndex.push_back(index);
     }
-    index++;
   }
+  // Neighbours are returned in ROI order, as for the exhaustive search
+  std::sort( clusterIndex.begin(), clusterIndex.end() );
   return clusterIndex;
 }
 
@@ -529,8 +615,8 @@ wireana::WireAnaDBSCAN::expandCluster(wireana::roi &r, int clusterID)
 float 
 wireana::WireAnaDBSCAN::calculateTickDistance(const wireana::roi &r1, const wireana::roi &r2)
   {
-    roi rr1 = (r1.begin_index < r2.begin_index)? r1 : r2;
-    roi rr2 = (r1.begin_index < r2.begin_index)? r2 : r1;
+    const roi &rr1 = (r1.begin_index < r2.begin_index)? r1 : r2;
+    const roi &rr2 = (r1.begin_index < r2.begin_index)? r2 : r1;
     float ret = rr2.begin_index - rr1.end_index;
     return (ret>0)? ret: 0;
   }
@@ -543,22 +629,232 @@ wireana::WireAnaDBSCAN::calculateDistance( const roi &r1, const roi &r2, float d
 }
 
 
+// Job-wide lookup of the wire crossings between channel pairs. The wire ids of
+// each channel and the crossings of each (channel, channel) pair are taken from
+// the geometry the first time they are needed; since both channels of a pair
+// belong to the same APA, this is a per-APA table filled only where it is used.
+// With SetChannelsPerShard each APA gets its own shard, so that different APAs
+// can be matched concurrently (but a single APA from only one thread at a time).
+// The table can be saved to and loaded from a file tagged with the detector name.
+class wireana::WireCrossingTable
+{
+  public:
+  WireCrossingTable( geo::GeometryCore const* geom ){
+    fGeometry = geom;
+    m_shards.resize(1);
+  }
+  ~WireCrossingTable(){}
+
+  void SetChannelsPerShard( int n );
+  const std::vector<geo::Point_t> &Crossings( raw::ChannelID_t c1, raw::ChannelID_t c2 );
+  bool ChannelsIntersect( raw::ChannelID_t c1, raw::ChannelID_t c2 );
+
+  bool Load( const std::string &fname );
+  bool Save( const std::string &fname ) const;
+
+  private:
+  struct Shard{
+    std::unordered_map< raw::ChannelID_t, std::vector<geo::WireID> > channelWires;
+    std::unordered_map< unsigned long long, std::vector<geo::Point_t> > crossings;
+    std::unordered_map< unsigned long long, bool > intersects;
+  };
+  static unsigned long long Key( raw::ChannelID_t c1, raw::ChannelID_t c2 ) { return ( (unsigned long long) c1 << 32 ) | c2; }
+  Shard &GetShard( raw::ChannelID_t c1 );
+  const std::vector<geo::WireID> &ChannelWires( Shard &shard, raw::ChannelID_t c );
+
+  geo::GeometryCore const* fGeometry;
+
+  int m_channelsPerShard = 0;
+  std::vector<Shard> m_shards;
+};
+
+void
+wireana::WireCrossingTable::SetChannelsPerShard( int n )
+{
+  //only meant to be called before the table is used, any content is dropped
+  m_channelsPerShard = (n > 0)? n : 0;
+  m_shards.clear();
+  m_shards.resize( (m_channelsPerShard > 0)? fGeometry->Nchannels()/m_channelsPerShard + 1 : 1 );
+}
+
+wireana::WireCrossingTable::Shard &
+wireana::WireCrossingTable::GetShard( raw::ChannelID_t c1 )
+{
+  if( m_channelsPerShard == 0 ) return m_shards.front();
+  size_t i = c1/m_channelsPerShard;
+  return ( i < m_shards.size() )? m_shards[i] : m_shards.back();
+}
+
+const std::vector<geo::WireID> &
+wireana::WireCrossingTable::ChannelWires( Shard &shard, raw::ChannelID_t c )
+{
+  auto it = shard.channelWires.find(c);
+  if( it == shard.channelWires.end() ) it = shard.channelWires.emplace( c, fGeometry->ChannelToWire(c) ).first;
+  return it->second;
+}
+
+const std::vector<geo::Point_t> &
+wireana::WireCrossingTable::Crossings( raw::ChannelID_t c1, raw::ChannelID_t c2 )
+{
+  //crossings between wires of different planes in the same tpc
+  Shard &shard = GetShard(c1);
+  auto it = shard.crossings.find( Key(c1,c2) );
+  if( it != shard.crossings.end() ) return it->second;
+  std::vector<geo::Point_t> points;
+  const auto &c1wid = ChannelWires(shard,c1);
+  const auto &c2wid = ChannelWires(shard,c2);
+  for( auto &w1: c1wid )
+  {
+    for( auto &w2: c2wid )
+    {
+      geo::Point_t point(-99999,-99999,-99999);
+      if ( w1.asTPCID() != w2.asTPCID() ) continue;
+      if ( w1.asPlaneID() == w2.asPlaneID() ) continue;
+      bool intersect = fGeometry->WireIDsIntersect(w1,w2,point);
+      if (intersect) points.push_back( point );
+    }
+  }
+  return shard.crossings.emplace( Key(c1,c2), std::move(points) ).first->second;
+}
+
+bool
+wireana::WireCrossingTable::ChannelsIntersect( raw::ChannelID_t c1, raw::ChannelID_t c2 )
+{
+  //same decision as the per-roi test of ROIMatcher::DeltaC
+  Shard &shard = GetShard(c1);
+  auto it = shard.intersects.find( Key(c1,c2) );
+  if( it != shard.intersects.end() ) return it->second;
+  bool intersect = false;
+  const auto &c1wid = ChannelWires(shard,c1);
+  const auto &c2wid = ChannelWires(shard,c2);
+  for( auto &w1: c1wid )
+  {
+    for( auto &w2: c2wid )
+    {
+      if( w1.asTPCID() != w2 ) continue;
+      geo::Point_t intersection_point;
+      intersect = fGeometry->WireIDsIntersect(w1,w2,intersection_point);
+      if( intersect ) break;
+    }
+  }
+  shard.intersects[ Key(c1,c2) ] = intersect;
+  return intersect;
+}
+
+bool
+wireana::WireCrossingTable::Load( const std::string &fname )
+{
+  std::ifstream in( fname, std::ios::binary );
+  if( !in ) return false;
+  std::string name;
+  std::getline( in, name );
+  if( name != fGeometry->DetectorName() )
+  {
+    std::cout<<"WireCrossingTable: "<<fname<<" was made for "<<name<<", ignoring it"<<std::endl;
+    return false;
+  }
+  size_t n = 0;
+  in.read( reinterpret_cast<char*>(&n), sizeof(n) );
+  for( size_t i = 0; in && i < n; i++ )
+  {
+    unsigned long long key = 0;
+    size_t npoints = 0;
+    in.read( reinterpret_cast<char*>(&key), sizeof(key) );
+    in.read( reinterpret_cast<char*>(&npoints), sizeof(npoints) );
+    std::vector<geo::Point_t> points;
+    for( size_t j = 0; in && j < npoints; j++ )
+    {
+      double xyz[3];
+      in.read( reinterpret_cast<char*>(xyz), sizeof(xyz) );
+      points.emplace_back( xyz[0], xyz[1], xyz[2] );
+    }
+    GetShard( key >> 32 ).crossings[key] = std::move(points);
+  }
+  n = 0;
+  in.read( reinterpret_cast<char*>(&n), sizeof(n) );
+  for( size_t i = 0; in && i < n; i++ )
+  {
+    unsigned long long key = 0;
+    char intersect = 0;
+    in.read( reinterpret_cast<char*>(&key), sizeof(key) );
+    in.read( &intersect, sizeof(intersect) );
+    GetShard( key >> 32 ).intersects[key] = intersect;
+  }
+  if( !in )
+  {
+    std::cout<<"WireCrossingTable: "<<fname<<" is truncated, ignoring it"<<std::endl;
+    for( auto &shard : m_shards )
+    {
+      shard.crossings.clear();
+      shard.intersects.clear();
+    }
+    return false;
+  }
+  return true;
+}
+
+bool
+wireana::WireCrossingTable::Save( const std::string &fname ) const
+{
+  std::ofstream out( fname, std::ios::binary | std::ios::trunc );
+  if( !out ) return false;
+  out << fGeometry->DetectorName() << '\n';
+  size_t n = 0;
+  for( auto &shard : m_shards ) n+= shard.crossings.size();
+  out.write( reinterpret_cast<const char*>(&n), sizeof(n) );
+  for( auto &shard : m_shards )
+  {
+    for( auto &kp : shard.crossings )
+    {
+      size_t npoints = kp.second.size();
+      out.write( reinterpret_cast<const char*>(&kp.first), sizeof(kp.first) );
+      out.write( reinterpret_cast<const char*>(&npoints), sizeof(npoints) );
+      for( auto &p : kp.second )
+      {
+        double xyz[3] = { p.X(), p.Y(), p.Z() };
+        out.write( reinterpret_cast<const char*>(xyz), sizeof(xyz) );
+      }
+    }
+  }
+  n = 0;
+  for( auto &shard : m_shards ) n+= shard.intersects.size();
+  out.write( reinterpret_cast<const char*>(&n), sizeof(n) );
+  for( auto &shard : m_shards )
+  {
+    for( auto &kb : shard.intersects )
+    {
+      char intersect = kb.second;
+      out.write( reinterpret_cast<const char*>(&kb.first), sizeof(kb.first) );
+      out.write( &intersect, sizeof(intersect) );
+    }
+  }
+  return bool(out);
+}
+
+
 class wireana::ROIMatcher
 {
   public:
-  ROIMatcher(double dist = 20 /*mm*/){
-    fGeometry = &*(art::ServiceHandle<geo::Geometry const>());
+  ROIMatcher( geo::GeometryCore const* geom, double dist = 20 /*mm*/){
     SetMatchDistance(dist);
+    m_ownCrossingTable = std::make_unique<WireCrossingTable>(geom);
+    m_crossingTable = m_ownCrossingTable.get();
   }
   ~ROIMatcher(){}
 
   void Reset();
-  void SetData( PlaneViewROIClusterMap pvrm ) { m_planeViewRoillusterMap = pvrm; }
+  //! The matched clusters point into pvrm, which must outlive them; planeid<0 matches all planes
+  void SetData( PlaneViewROIClusterMap &pvrm, int planeid = -1 ) { m_planeViewRoillusterMap = &pvrm; m_planeid = planeid; }
   void SetMatchDistance( float dist = 20 /*mm*/ ) { m_minMatchDistance = dist ;}
+  void SetTickTolerance( int ticks = 0 ) { m_tickTolerance = ticks; } // negative disables the time pruning
+  void SetCrossingTable( WireCrossingTable *table ) { m_crossingTable = table? table : m_ownCrossingTable.get(); }
+  void SetUseDeltaC( bool use = true ) { m_useDeltaC = use; }
+  void SetVerbose( bool verbose = true ) { m_verbose = verbose; }
   void MatchROICluster();
   void CleanDuplicates( float delta = 0. );
   void SortROIClustersBySize();
   const std::vector<matchedroicluster> &GetMatchedClusters() { return m_matchedclusters; }
+  std::vector<matchedroicluster> TakeMatchedClusters() { return std::move(m_matchedclusters); }
 
   private:
   bool OverlapInTime(const roicluster& r1, const roicluster& r2, double frac=.8);
@@ -569,30 +865,37 @@ class wireana::ROIMatcher
 
   std::vector<geo::Point_t> GetIntersectionPoints(const roicluster& r1, const roicluster& r2);
   double DeltaDist(const roicluster& r1, const roicluster& r2, const roicluster& r3);
+  double DeltaDist(const std::vector<geo::Point_t>& uv, const std::vector<geo::Point_t>& uz, const std::vector<geo::Point_t>& vz);
+  bool CompatibleInTime(const roicluster& r1, const roicluster& r2);
 
   double DeltaN(const roicluster& r1, const roicluster& r2);
   double DeltaCT( const wireana::roicluster& r1, const wireana::roicluster &r2 );
 
-  geo::GeometryCore const* fGeometry;
-
-  PlaneViewROIClusterMap m_planeViewRoillusterMap;
+  PlaneViewROIClusterMap *m_planeViewRoillusterMap = nullptr;
+  int m_planeid = -1;
   std::vector<matchedroicluster> m_matchedclusters; 
 
   double m_minMatchDistance;
+  int m_tickTolerance = 0;
+  bool m_useDeltaC = false;
+  bool m_verbose = true;
+  std::unique_ptr<WireCrossingTable> m_ownCrossingTable; //used when no job-wide table is given; on the heap, so m_crossingTable survives a move
+  WireCrossingTable *m_crossingTable;
 };
 
 void 
 wireana::ROIMatcher::Reset()
 {
-  m_planeViewRoillusterMap.clear();
+  m_planeViewRoillusterMap = nullptr;
+  m_planeid = -1;
   m_matchedclusters.clear();
 }
 
 bool 
 wireana::ROIMatcher::OverlapInTime(const roicluster& r1, const roicluster& r2, double frac)
 {
-  roicluster rr1 = (r1.begin_index < r2.begin_index)? r1 : r2;
-  roicluster rr2 = (r1.begin_index < r2.begin_index)? r2 : r1;
+  const roicluster &rr1 = (r1.begin_index < r2.begin_index)? r1 : r2;
+  const roicluster &rr2 = (r1.begin_index < r2.begin_index)? r2 : r1;
   bool overlap = (rr2.begin_index - rr1.end_index)<=0;
   //must overlap and similar sized
   int dt1 = rr1.end_index - rr1.begin_index;
@@ -618,31 +921,12 @@ wireana::ROIMatcher::DeltaN(const wireana::roicluster& r1, const wireana::roiclu
 double
 wireana::ROIMatcher::DeltaC(const roicluster& r1, const roicluster& r2)
 {
+  //number of roi channel pairs without a wire crossing
   double ret = 0;
-  std::map<raw::ChannelID_t, std::vector<geo::WireID>> cwidmap;
-  for( auto &rr1 : r1.ROIs ){
-    raw::ChannelID_t c1 = rr1.wire->Channel();
-    auto c1towid = fGeometry->ChannelToWire(c1);
-    for( auto &rr2: r2.ROIs )
-    {
-      //double y,z;
-      raw::ChannelID_t c2 = rr2.wire->Channel();
-      if( cwidmap.find(c2) == cwidmap.end() ) cwidmap[c2] = fGeometry->ChannelToWire(c2);
-      //loop through each wid, set intersect to true if any has intersection
-
-      bool intersect = false;
-      for( auto &w1: c1towid )
-      {
-        for( auto &w2: cwidmap[c2] )
-        {
-          if( w1.asTPCID() != w2 ) continue;
-          geo::Point_t intersection_point;
-          intersect = fGeometry->WireIDsIntersect(w1,w2,intersection_point);
-          if( intersect ) break;
-        }
-      }
-      ret+= (!intersect);
-    };
+  for( size_t i1 = 0; i1 < r1.NROIs(); i1++ )
+  {
+    int c1 = r1.ROI(i1).channel;
+    for( size_t i2 = 0; i2 < r2.NROIs(); i2++ ) ret+= !m_crossingTable->ChannelsIntersect( c1, r2.ROI(i2).channel );
   }
   return ret;
 }
@@ -650,23 +934,8 @@ wireana::ROIMatcher::DeltaC(const roicluster& r1, const roicluster& r2)
 std::vector<geo::Point_t>
 wireana::ROIMatcher::GetIntersectionPoints( const roicluster& r1, const roicluster& r2)
 {
-
-  std::vector<geo::Point_t> points;
   int c1 = std::round(r1.centroidChannel), c2 = std::round(r2.centroidChannel);
-  std::vector< geo::WireID > c1wid = fGeometry->ChannelToWire( c1 );
-  std::vector< geo::WireID > c2wid = fGeometry->ChannelToWire( c2 );
-  for( auto &w1: c1wid )
-  {
-    for( auto &w2:c2wid )
-    {
-      geo::Point_t point(-99999,-99999,-99999);
-      if ( w1.asTPCID() != w2.asTPCID() ) continue;
-      if ( w1.asPlaneID() == w2.asPlaneID() ) continue;
-      bool intersect = fGeometry->WireIDsIntersect(w1,w2,point);
-      if (intersect) points.push_back( point );
-    }
-  }
-  return points;
+  return m_crossingTable->Crossings( c1, c2 );
 }
 
 double 
@@ -675,6 +944,12 @@ wireana::ROIMatcher::DeltaDist( const roicluster &u, const roicluster &v, const
   auto uv = wireana::ROIMatcher::GetIntersectionPoints(u,v);
   auto uz = wireana::ROIMatcher::GetIntersectionPoints(u,z);
   auto vz = wireana::ROIMatcher::GetIntersectionPoints(v,z);
+  return DeltaDist( uv, uz, vz );
+}
+
+double 
+wireana::ROIMatcher::DeltaDist( const std::vector<geo::Point_t>& uv, const std::vector<geo::Point_t>& uz, const std::vector<geo::Point_t>& vz )
+{
   if (uv.size() == 0 || uz.size() == 0 || vz.size() == 0 ) return false;
   //then find the maximum delta distance between each triplet
   std::vector<double> distances;
@@ -699,13 +974,20 @@ wireana::ROIMatcher::DeltaDist( const roicluster &u, const roicluster &v, const
   return *std::min_element( distances.begin(), distances.end() );
 }
 
+bool
+wireana::ROIMatcher::CompatibleInTime( const roicluster& r1, const roicluster& r2 )
+{
+  if ( m_tickTolerance < 0 ) return true;
+  return ( r1.begin_index - r2.end_index <= m_tickTolerance && r2.begin_index - r1.end_index <= m_tickTolerance );
+}
+
 double 
 wireana::ROIMatcher::DeltaCT( const wireana::roicluster& r1, const wireana::roicluster &r2 )
 {
   double dT=0,dN=0,dC=0;
   dT = DeltaT(r1,r2);
   dN = DeltaN(r1,r2);
-  //dC = DeltaC(r1,r2);
+  if( m_useDeltaC ) dC = DeltaC(r1,r2);
   return dT+dN+dC;
 }
 
@@ -719,26 +1001,86 @@ void
 wireana::ROIMatcher::MatchROICluster()
 {
   m_matchedclusters.clear();
+  if( !m_planeViewRoillusterMap ) return;
 
-  for( auto& pvv: m_planeViewRoillusterMap )//plane: (view, vector<roicluster>)
+  for( auto& pvv: *m_planeViewRoillusterMap )//plane: (view, vector<roicluster>)
   {
     int planeid = pvv.first;
+    if( m_planeid >= 0 && planeid != m_planeid ) continue;
     //u=0, v=1, z=2
-    for( auto & rcu: pvv.second[geo::kU] )
+    std::vector<roicluster> &rcus = pvv.second[geo::kU];
+    std::vector<roicluster> &rcvs = pvv.second[geo::kV];
+    std::vector<roicluster> &rczs = pvv.second[geo::kZ];
+
+    //centroid channels, whose crossings are looked up in the crossing table
+    auto centroidChannels = []( const std::vector<roicluster> &rcs ){
+      std::vector<int> channels( rcs.size() );
+      for( size_t i = 0; i < rcs.size(); i++ ) channels[i] = std::round(rcs[i].centroidChannel);
+      return channels;
+    };
+    auto uchannels = centroidChannels( rcus );
+    auto vchannels = centroidChannels( rcvs );
+    auto zchannels = centroidChannels( rczs );
+
+    //z clusters sorted by start tick for the time sweep
+    std::vector<int> zorder( rczs.size() );
+    std::vector<int> zbegin( rczs.size() );
+    int zmaxwidth = 0;
+    for( size_t i = 0; i < rczs.size(); i++ )
+    {
+      zorder[i] = i;
+      zmaxwidth = std::max( zmaxwidth, rczs[i].end_index - rczs[i].begin_index );
+    }
+    std::stable_sort( zorder.begin(), zorder.end(), [&rczs]( int a, int b ){ return rczs[a].begin_index < rczs[b].begin_index; } );
+    for( size_t i = 0; i < zorder.size(); i++ ) zbegin[i] = rczs[zorder[i]].begin_index;
+
+    std::vector<int> zcandidates;
+    for( size_t iu = 0; iu < rcus.size(); iu++ )
     {
+      auto &rcu = rcus[iu];
       if( rcu.clusterID < 0 ) continue;
-      int n_rcu = rcu.ROIs.size();
-      for( auto & rcv: pvv.second[geo::kV] )
+      int n_rcu = rcu.NROIs();
+      for( size_t iv = 0; iv < rcvs.size(); iv++ )
       {
+        auto &rcv = rcvs[iv];
         if( rcv.clusterID < 0 ) continue;
-        int n_rcv = rcv.ROIs.size();
+        if( !CompatibleInTime(rcu,rcv) ) continue;
+        const auto &uvpoints = m_crossingTable->Crossings( uchannels[iu], vchannels[iv] );
+        if( uvpoints.size() == 0 ) continue;
+        int n_rcv = rcv.NROIs();
         double uv = DeltaCT(rcu,rcv);
-        for( auto & rcz: pvv.second[geo::kZ] )
+
+        //z clusters overlapping both u and v in time, in their original order
+        zcandidates.clear();
+        if( m_tickTolerance < 0 )
+        {
+          for( size_t iz = 0; iz < rczs.size(); iz++ ) zcandidates.push_back(iz);
+        }
+        else
         {
+          int tmin = std::max( rcu.begin_index, rcv.begin_index ) - m_tickTolerance - zmaxwidth;
+          int tmax = std::min( rcu.end_index, rcv.end_index ) + m_tickTolerance;
+          auto first = std::lower_bound( zbegin.begin(), zbegin.end(), tmin );
+          auto last = std::upper_bound( first, zbegin.end(), tmax );
+          for( auto it = first; it != last; ++it )
+          {
+            int iz = zorder[it - zbegin.begin()];
+            if( CompatibleInTime(rcu,rczs[iz]) && CompatibleInTime(rcv,rczs[iz]) ) zcandidates.push_back(iz);
+          }
+          std::sort( zcandidates.begin(), zcandidates.end() );
+        }
+
+        for( int iz : zcandidates )
+        {
+          auto &rcz = rczs[iz];
           if( rcz.clusterID < 0 ) continue;
-          double dist = DeltaDist( rcu,rcv,rcz );
+          const auto &uzp = m_crossingTable->Crossings( uchannels[iu], zchannels[iz] );
+          if( uzp.size() == 0 ) continue;
+          const auto &vzp = m_crossingTable->Crossings( vchannels[iv], zchannels[iz] );
+          if( vzp.size() == 0 ) continue;
+          double dist = DeltaDist( uvpoints, uzp, vzp );
           if( dist > m_minMatchDistance ) continue;
-          int n_rcz = rcz.ROIs.size();
+          int n_rcz = rcz.NROIs();
           double uz = DeltaCT(rcu,rcz);
           double vz = DeltaCT(rcv,rcz);
           double metric = pow( uv*uv+uz*uz+vz*vz, 0.5 )/pow(n_rcu+n_rcv+n_rcz,3);
@@ -753,37 +1095,160 @@ wireana::ROIMatcher::MatchROICluster()
 void 
 wireana::ROIMatcher::CleanDuplicates(float delta)
 {
+  // A matched cluster is dropped if it shares a roicluster with an earlier kept one
+  // whose metric differs by more than delta. The kept clusters are walked once, recording
+  // for each roicluster (plane, view, cluster id) the metric range of the kept clusters using it.
   if ( m_matchedclusters.size() == 0 ) return;
-  std::cout<<"Initial Matched Clusters Size: "<<m_matchedclusters.size()<<std::endl;
-  auto it = m_matchedclusters.begin(); 
-  while ( it != m_matchedclusters.end() )
+  if ( m_verbose ) std::cout<<"Initial Matched Clusters Size: "<<m_matchedclusters.size()<<std::endl;
+  auto clusterKey = []( const roicluster &c ){
+    return ( (unsigned long long) (unsigned int) c.planeid << 40 ) ^ ( (unsigned long long) (unsigned int) c.view << 32 ) ^ (unsigned int) c.clusterID;
+  };
+  std::unordered_map< unsigned long long, std::pair<double,double> > used; //key -> (min, max) kept metric
+  size_t nkept = 0;
+  for( size_t i = 0; i < m_matchedclusters.size(); i++ )
   {
-    //it->clusters;
-    auto it2 = it+1;
-    while ( it2 != m_matchedclusters.end() )
+    auto &mc = m_matchedclusters[i];
+    bool found_duplicate_cluster = false;
+    for( auto &clus : mc.clusters )
     {
-      //loop over rest of the clusters and remove any that contains duplicate clusters. 
-      bool found_duplicate_cluster = false;
-      if( std::abs(it->metric - it2->metric) > delta )
+      auto it = used.find( clusterKey(*clus) );
+      if ( it == used.end() ) continue;
+      if ( std::abs(mc.metric - it->second.first) > delta || std::abs(mc.metric - it->second.second) > delta )
       {
-        for( auto clus = it2->clusters.begin(); clus != it2->clusters.end(); ++clus )
+        found_duplicate_cluster = true;
+        break;
+      }
+    }
+    if ( found_duplicate_cluster ) continue;
+    if ( !std::isnan(mc.metric) )
+    {
+      for( auto &clus : mc.clusters )
+      {
+        auto ins = used.emplace( clusterKey(*clus), std::make_pair(mc.metric, mc.metric) );
+        if ( !ins.second )
         {
-          if ( std::find( it->clusters.begin(), it->clusters.end(), *clus ) != it->clusters.end() )
-          {
-            //found roicluster
-            found_duplicate_cluster = true;
-            break;
-          }
+          ins.first->second.first = std::min( ins.first->second.first, mc.metric );
+          ins.first->second.second = std::max( ins.first->second.second, mc.metric );
         }
       }
-      if ( found_duplicate_cluster ) 
-        m_matchedclusters.erase( it2 ); 
-      // since current it2 erased, it2 automatically becomes the "next" element
-      else ++it2;
     }
-    ++it;
+    if ( nkept != i ) m_matchedclusters[nkept] = std::move(mc);
+    ++nkept;
+  }
+  m_matchedclusters.erase( m_matchedclusters.begin()+nkept, m_matchedclusters.end() );
+  if ( m_verbose ) std::cout<<"Final Matched Clusters Size: "<<m_matchedclusters.size()<<std::endl;
+}
+
+
+// Writes fixed-shape float32 rows (e.g. the three view images of a matched cluster)
+// as one contiguous array per .npy file, shape (N, row shape...). Rows are buffered
+// and appended in chunks; a new file "<prefix><n>.npy" is started every maxRows rows,
+// the same way c2numpy splits its files, so row i of both outputs is the same cluster.
+class wireana::numpywriter
+{
+  public:
+  numpywriter(){}
+  ~numpywriter(){ Close(); }
+
+  void Init( const std::string &prefix, const std::vector<size_t> &rowShape, int maxRows, int chunkRows = 256 );
+  void Append( const std::vector<float> &row );
+  void Close();
+
+  private:
+  static const size_t kHeaderSize = 128;
+  void Open();
+  void Flush();
+  void WriteHeader();
+
+  std::string m_prefix;
+  std::vector<size_t> m_rowShape;
+  size_t m_rowSize = 0;
+  int m_maxRows = 0;
+  int m_chunkRows = 256;
+  int m_fileNumber = 0;
+  long m_rowsInFile = 0;
+  std::vector<float> m_buffer;
+  std::ofstream m_file;
+};
+
+void
+wireana::numpywriter::Init( const std::string &prefix, const std::vector<size_t> &rowShape, int maxRows, int chunkRows )
+{
+  Close();
+  m_prefix = prefix;
+  m_rowShape = rowShape;
+  m_rowSize = 1;
+  for( auto n : rowShape ) m_rowSize*= n;
+  m_maxRows = maxRows;
+  m_chunkRows = (chunkRows > 0)? chunkRows : 1;
+  m_fileNumber = 0;
+  m_buffer.clear();
+  m_buffer.reserve( m_chunkRows*m_rowSize );
+}
+
+void
+wireana::numpywriter::Open()
+{
+  m_file.open( m_prefix + std::to_string(m_fileNumber) + ".npy", std::ios::binary | std::ios::trunc );
+  m_rowsInFile = 0;
+  WriteHeader(); //placeholder, rewritten with the final row count on close
+}
+
+void
+wireana::numpywriter::WriteHeader()
+{
+  //npy v1.0: magic, version, header length, then the dict padded with spaces to a fixed size
+  std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(m_rowsInFile) + ",";
+  for( auto n : m_rowShape ) dict+= " " + std::to_string(n) + ",";
+  dict+= "), }";
+  dict.resize( kHeaderSize - 10 - 1, ' ' );
+  dict+= '\n';
+  unsigned short len = dict.size();
+  const char magic[8] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+  m_file.seekp(0);
+  m_file.write( magic, 8 );
+  m_file.put( len & 0xff );
+  m_file.put( len >> 8 );
+  m_file.write( dict.data(), dict.size() );
+  m_file.seekp( 0, std::ios::end );
+}
+
+void
+wireana::numpywriter::Append( const std::vector<float> &row )
+{
+  if( row.size() != m_rowSize )
+  {
+    std::cout<<"numpywriter: row of size "<<row.size()<<" does not match "<<m_rowSize<<", skipping it"<<std::endl;
+    return;
   }
-  std::cout<<"Final Matched Clusters Size: "<<m_matchedclusters.size()<<std::endl;
+  if( !m_file.is_open() ) Open();
+  m_buffer.insert( m_buffer.end(), row.begin(), row.end() );
+  ++m_rowsInFile;
+  if( m_rowsInFile == m_maxRows )
+  {
+    Flush();
+    WriteHeader();
+    m_file.close();
+    ++m_fileNumber;
+  }
+  else if( (int) (m_buffer.size()/m_rowSize) >= m_chunkRows ) Flush();
+}
+
+void
+wireana::numpywriter::Flush()
+{
+  if( m_buffer.empty() ) return;
+  m_file.write( reinterpret_cast<const char*>( m_buffer.data() ), m_buffer.size()*sizeof(float) );
+  m_buffer.clear();
+}
+
+void
+wireana::numpywriter::Close()
+{
+  if( !m_file.is_open() ) return;
+  Flush();
+  WriteHeader();
+  m_file.close();
 }
 
 #endif
@@ -4,6 +4,7 @@
 
 wireana::WireAna::WireAna(fhicl::ParameterSet const& pset)
   : EDAnalyzer{pset}  ,
+  fCrossingTable(lar::providerFrom<geo::Geometry>()),
   fWireProducerLabel(pset.get< art::InputTag >("InputWireProducerLabel", "caldata")),
   fSimChannelLabel(pset.get< art::InputTag >("SimChannelLabel", "elecDrift")),
   fSimulationProducerLabel(pset.get< art::InputTag >("SimulationProducerLabel", "largeant"))
@@ -22,6 +23,11 @@ wireana::WireAna::WireAna(fhicl::ParameterSet const& pset)
   fPitch   =  pset.get<float>("DBSCAN_Pitch", 3.0);
 
   fDeltaMetric = pset.get<float>("CleanClusterDeltaScore", 0.01);
+  fMatchTickTolerance = pset.get<int>("MatchTickTolerance", 0);
+  fUseDeltaC   = pset.get<bool>("UseDeltaC", false);
+  fCrossingCacheFile = pset.get<std::string>("WireCrossingCache", "");
+  fParallelAPAs = pset.get<bool>("ParallelAPAs", true);
+  fCrossingTable.SetChannelsPerShard(fNChanPerApa);
 
   image_channel_width  = pset.get<int>("IMAGE_CHANNEL_WIDTH",13); 
   image_tick_width     = pset.get<int>("IMAGE_TICK_WIDTH",400); 
@@ -30,6 +36,7 @@ wireana::WireAna::WireAna(fhicl::ParameterSet const& pset)
 
   fDumpFileName      = pset.get<std::string>("DUMPFILENAME", "out.npy");
   fDumpMaxRow        = pset.get<int>("DUMPMAXROW", 50000);
+  fDumpImageColumns  = pset.get<bool>("DUMPIMAGECOLUMNS", false);
   fDumpNClusters     = pset.get<int>("DUMPNCLUSTERS",-1);
 
 
@@ -214,21 +221,19 @@ void wireana::WireAna::analyze(art::Event const & evt) {
 
 
     //Match ROI across views
-    ROIMatcher matcher;
-    matcher.SetData(plane_view_roicluster_map);
-    matcher.MatchROICluster();
-    if( fLogLevel>=10 ) std::cout<<"matcher.MatchROICluster(): Done"<<std::endl;
-    matcher.CleanDuplicates(fDeltaMetric);
-    bool hasCluster = (matcher.GetMatchedClusters().size() != 0 );
+    std::vector<wireana::matchedroicluster> matchedclusters = MatchROIClusters( lar::providerFrom<geo::Geometry>() );
+    if( fLogLevel>=10 ) std::cout<<"MatchROIClusters(): Done"<<std::endl;
+    bool hasCluster = (matchedclusters.size() != 0 );
     if( hasCluster )
     {
-      matcher.SortROIClustersBySize();
+      std::sort(matchedclusters.begin(), matchedclusters.end(),
+          [](const auto &a, const auto &b){ return a.totalROIs > b.totalROIs; });
       //Logs
       if( fLogLevel >= 2 )
       {
         std::cout<<"  List Matched Clusters: "<<std::endl;
         int i = 0;
-        for( auto mc : matcher.GetMatchedClusters() )
+        for( auto &mc : matchedclusters )
         {
           if (i == fDumpNClusters) break;
           std::cout<<"    Item "<<i<<", PlaneID: "<<mc.planeid<<std::endl
@@ -236,35 +241,35 @@ void wireana::WireAna::analyze(art::Event const & evt) {
           for( int v=0;v<3;v++ )
           {
            std::cout<<Form("        View: %d, tick(%d, %d, %d), ch(%d, %d, %d)",
-                        mc.clusters[v].view,
-                        mc.clusters[v].begin_index,
-                        mc.clusters[v].end_index,
-                        mc.clusters[v].end_index-mc.clusters[v].begin_index,
-                        mc.clusters[v].channel_min,
-                        mc.clusters[v].channel_max, 
-                        mc.clusters[v].channel_max-mc.clusters[v].channel_min
+                        mc.clusters[v]->view,
+                        mc.clusters[v]->begin_index,
+                        mc.clusters[v]->end_index,
+                        mc.clusters[v]->end_index-mc.clusters[v]->begin_index,
+                        mc.clusters[v]->channel_min,
+                        mc.clusters[v]->channel_max, 
+                        mc.clusters[v]->channel_max-mc.clusters[v]->channel_min
                         )<<std::endl;
           }
           if (MC)
           {
             std::cout<<"    Matched Truth::(GenCode, LabelMatch, GenTrkMatch): "<<std::endl;
             std::cout<<Form("                   (%d, %d, %d) ", mc.gencode(), mc.labelmatch(),mc.trkmatch())<<std::endl;
-            std::cout<<Form("                   first label: %s",mc.clusters[0].label.c_str() )<<std::endl;
+            std::cout<<Form("                   first label: %s",mc.clusters[0]->label.c_str() )<<std::endl;
           }
           ++i;
         }
       }//end Logs
 
       int nDumpedClusters = 0;
-      for( auto  mCluster : matcher.GetMatchedClusters() )
+      for( auto &mCluster : matchedclusters )
       {
         if (nDumpedClusters == fDumpNClusters ) break;
 
         //matchedroicluster mCluster = matcher.GetMatchedClusters().front();
         int ch_width=image_channel_width,tick_width= image_tick_width, nticks=image_rebin_tick;
-        std::vector<double> u_vec = GetArrayFromWire( wirelist, mCluster.clusters[0], ch_width,tick_width);
-        std::vector<double> v_vec = GetArrayFromWire( wirelist, mCluster.clusters[1], ch_width,tick_width);
-        std::vector<double> z_vec = GetArrayFromWire( wirelist, mCluster.clusters[2], ch_width,tick_width);
+        std::vector<double> u_vec = GetArrayFromWire( wirelist, *mCluster.clusters[0], ch_width,tick_width);
+        std::vector<double> v_vec = GetArrayFromWire( wirelist, *mCluster.clusters[1], ch_width,tick_width);
+        std::vector<double> z_vec = GetArrayFromWire( wirelist, *mCluster.clusters[2], ch_width,tick_width);
 
         if( fLogLevel >= 3 ) std::cout<<"  Got all ArrayFromWire: "<<std::endl;
         std::vector<double> u_vecc = CombineTicks( u_vec, ch_width, nticks );
@@ -311,6 +316,11 @@ void wireana::WireAna::beginJob() {
 
   gROOT->SetBatch(1);
 
+  if( fMakeCluster && fCrossingCacheFile != "" && fCrossingTable.Load(fCrossingCacheFile) )
+  {
+    if( fLogLevel>=1 ) std::cout<<"Loaded wire crossings from "<<fCrossingCacheFile<<std::endl;
+  }
+
   art::ServiceHandle<art::TFileService> tfs;
   fTree = tfs->make<TTree>(fTreeName.c_str() ,fTreeName.c_str() );
 
@@ -388,13 +398,19 @@ void wireana::WireAna::beginJob() {
     c2numpy_addcolumn(&npywriter, "Part_Pz", C2NUMPY_FLOAT );
 
 
-    //setup index data
-    for( int i = 0; i < image_size; i++ )
+    //setup image data, one contiguous array per file
+    imagewriter.Init( fDumpFileName+"_images", { 3, (size_t) (image_tick_width/image_rebin_tick), (size_t) image_channel_width }, fDumpMaxRow );
+
+    //legacy per-pixel columns
+    if( fDumpImageColumns )
     {
-      for( int v = 0; v < 3; v++ )
+      for( int i = 0; i < image_size; i++ )
       {
-        std::string name=Form("%s_%08d", fViewMap[v].c_str(),i);
-        c2numpy_addcolumn(&npywriter, name.c_str(), C2NUMPY_FLOAT);
+        for( int v = 0; v < 3; v++ )
+        {
+          std::string name=Form("%s_%08d", fViewMap[v].c_str(),i);
+          c2numpy_addcolumn(&npywriter, name.c_str(), C2NUMPY_FLOAT);
+        }
       }
     }
   }// end fMakeCluster
@@ -406,7 +422,15 @@ void wireana::WireAna::beginJob() {
 
 void wireana::WireAna::endJob()
 {
-  if(fMakeCluster) c2numpy_close(&npywriter);
+  if(fMakeCluster)
+  {
+    c2numpy_close(&npywriter);
+    imagewriter.Close();
+  }
+  if(fMakeCluster && fCrossingCacheFile != "" && !fCrossingTable.Save(fCrossingCacheFile) )
+  {
+    std::cout<<"Could not write wire crossings to "<<fCrossingCacheFile<<std::endl;
+  }
 }
 
 
@@ -609,52 +633,89 @@ void wireana::WireAna::PrintClusters( std::vector<wirecluster> &clusters )
 }
 
 
+void
+wireana::WireAna::RunPerAPA( const std::vector<int> &apas, const std::function<void(int)> &task )
+{
+  //APAs are independent: each task only touches the entries of its own APA,
+  //which must already exist in the maps it writes to
+  if( !fParallelAPAs )
+  {
+    for( int apa : apas ) task(apa);
+    return;
+  }
+  tbb::parallel_for( tbb::blocked_range<size_t>(0, apas.size(), 1),
+      [&]( const tbb::blocked_range<size_t> &r ){
+        for( size_t i = r.begin(); i != r.end(); ++i ) task( apas[i] );
+      } );
+}
+
 void
 wireana::WireAna::BuildPlaneViewROIMap(  std::vector<art::Ptr<recob::Wire>> &wires )
 {
   //First get all rois
   //I assume the wires are already grouped by APA and view, because we don't want to
   //search over the entire DUNE volume all at once.
-  for( const auto &wire: wires )
+  std::map<int, std::vector<size_t>> apawires;
+  for( size_t i = 0; i < wires.size(); i++ ) apawires[ wires[i]->Channel()/fNChanPerApa ].push_back(i);
+  std::vector<int> apas;
+  for( auto &aw : apawires )
+  {
+    apas.push_back( aw.first );
+    plane_view_roi_map[aw.first];
+  }
+
+  RunPerAPA( apas, [&]( int planeID ){
+    std::map< geo::View_t, std::vector<roi> > view_roi_map;
+    for( size_t i : apawires.at(planeID) )
+    {
+      const auto &wire = wires[i];
+      size_t nranges = wire->SignalROI().n_ranges();
+      auto &rois = view_roi_map[wire->View()];
+      for ( size_t r = 0; r < nranges; r++ ) rois.emplace_back( wire, r );
+    }
+    plane_view_roi_map.at(planeID) = std::move(view_roi_map);
+  } );
+
+  //printed here rather than from the (possibly concurrent) APA tasks
+  if( fLogLevel>=10 )
   {
-    raw::ChannelID_t chan = wire->Channel();
-    int planeID = chan/fNChanPerApa;
-    recob::Wire::RegionsOfInterest_t signalROI = wire->SignalROI();
-    auto dataranges = signalROI.get_ranges();
-    if( fLogLevel>=10 ) std::cout<<"Channel "<<chan<<" has "<<dataranges.size()<<" ranges"<<std::endl;
-    for ( auto datarange: dataranges ) {
-      if( fLogLevel>=10 ) std::cout<<"BuildPlaneViewROIMap(): create roi"<<std::endl;
-      wireana::roi thisroi( wire, datarange );
-      if( fLogLevel>=10 ) std::cout<<"BuildPlaneViewROIMap(): created roi"<<std::endl;
-      plane_view_roi_map[planeID][wire->View()].push_back( thisroi );
-      if( fLogLevel>=10 ) std::cout<<"BuildPlaneViewROIMap(): push_back -- done"<<std::endl;
+    for( auto &aw : apawires )
+    {
+      for( size_t i : aw.second ) std::cout<<"Channel "<<wires[i]->Channel()<<" has "<<wires[i]->SignalROI().n_ranges()<<" ranges"<<std::endl;
     }
   }
 }
 
 void wireana::WireAna::BuildInitialROIClusters()
 {
-  wireana::WireAnaDBSCAN scanner;
-  for( auto &p: plane_view_roi_map ) //loop over planeid
+  std::vector<int> apas;
+  for( auto &p: plane_view_roi_map )
   {
+    apas.push_back( p.first );
+    for( auto &v: p.second ) plane_view_roicluster_map[p.first][v.first];
+  }
+
+  RunPerAPA( apas, [&]( int planeID ){
+    wireana::WireAnaDBSCAN scanner;
     //Internal clustering of ROIs
-    for( auto &v: p.second ) //loop over view
+    for( auto &v: plane_view_roi_map.at(planeID) ) //loop over view
     {
       scanner.SetParameters(v.second, fMinPts, fEps, fDrift, fPitch );
       scanner.run();
       std::map<int, wireana::roicluster> idclusmap;
       for( unsigned int i = 0; i<v.second.size(); i++ )
       {
-        idclusmap[ v.second[i].clusterID ].AddROI( v.second[i], p.first );
+        idclusmap[ v.second[i].clusterID ].AddROI( v.second, i, planeID );
       }
-      for( auto idclus: idclusmap )
+      std::vector<wireana::roicluster> &clusters = plane_view_roicluster_map.at(planeID).at(v.first);
+      clusters.reserve( idclusmap.size() );
+      for( auto &idclus: idclusmap )
       {
-        plane_view_roicluster_map[p.first][v.first].push_back(idclus.second);
+        clusters.push_back( std::move(idclus.second) );
       }
-      std::sort(plane_view_roicluster_map[p.first][v.first].begin(), plane_view_roicluster_map[p.first][v.first].end(),[]( auto &a, auto &b ){ return a.nWires > b.nWires; } );
-  //std::sort( trkID_sum.begin(), trkID_sum.end(), [](auto &a, auto &b){ return a.second.first > b.second.first;} );
+      std::sort(clusters.begin(), clusters.end(),[]( auto &a, auto &b ){ return a.nWires > b.nWires; } );
     }
-  }
+  } );
 
   //if( fLogLevel >= 3 )
   //{
@@ -679,7 +740,7 @@ void wireana::WireAna::BuildInitialROIClusters()
       for( const auto &v: p.second )
       {
         std::cout<<"    View: "<<v.first<<std::endl;
-        for ( const auto &cluster: v.second ) PrintROIs( cluster.ROIs );
+        for ( const auto &cluster: v.second ) PrintROIs( cluster );
       }
     }
   }
@@ -688,6 +749,58 @@ void wireana::WireAna::BuildInitialROIClusters()
   return;
 }
 
+std::vector<wireana::matchedroicluster>
+wireana::WireAna::MatchROIClusters( geo::GeometryCore const* geom )
+{
+  //each APA is matched and cleaned on its own; the results are merged in APA order
+  std::vector<int> apas;
+  std::map<int, std::vector<wireana::matchedroicluster>> apamatches;
+  for( auto &p: plane_view_roicluster_map )
+  {
+    apas.push_back( p.first );
+    apamatches[p.first];
+  }
+
+  RunPerAPA( apas, [&]( int planeID ){
+    ROIMatcher matcher(geom);
+    matcher.SetData(plane_view_roicluster_map, planeID);
+    matcher.SetTickTolerance(fMatchTickTolerance);
+    matcher.SetCrossingTable(&fCrossingTable);
+    matcher.SetUseDeltaC(fUseDeltaC);
+    matcher.SetVerbose(false);
+    matcher.MatchROICluster();
+    matcher.CleanDuplicates(fDeltaMetric);
+    apamatches.at(planeID) = matcher.TakeMatchedClusters();
+  } );
+
+  std::vector<wireana::matchedroicluster> matchedclusters;
+  for( auto &am : apamatches )
+  {
+    for( auto &mc : am.second ) matchedclusters.push_back( std::move(mc) );
+  }
+  std::stable_sort(matchedclusters.begin(), matchedclusters.end(),
+      [](const auto &a, const auto &b){ return a.metric < b.metric; });
+  if( fLogLevel>=1 ) std::cout<<"Matched Clusters Size: "<<matchedclusters.size()<<std::endl;
+  return matchedclusters;
+}
+
+
+void 
+wireana::WireAna::PrintROIs( const wireana::roicluster &cluster )
+{
+  std::cout<<"Printing ROIs"<<std::endl;
+  for( size_t i = 0; i < cluster.NROIs(); i++ )
+  {
+    const auto &roi = cluster.ROI(i);
+    if (roi.clusterID == NOISE ) continue;
+    std::cout<<Form(
+        "\t\tClusID: %d \n\t\t\t\tChannel: %d, Index: (%d,%d,%d), |Sum|: %f", 
+        roi.clusterID, 
+        roi.channel, roi.begin_index, roi.end_index, roi.end_index-roi.begin_index,roi.abs_sum
+        )
+      <<std::endl;
+  }
+}
 
 void 
 wireana::WireAna::PrintROIs( const std::vector<wireana::roi> &ROIs)
@@ -815,8 +928,9 @@ wireana::WireAna::TagROIClusterTruth( wireana::roicluster &cluster, const detinf
   if (fLogLevel>=10) std::cout<<"Entering TagROIClusterTruth"<<std::endl;
 
   std::vector< std::pair< int, std::pair<float,float> > > trkID_sum; 
-  for ( auto& roi: cluster.ROIs ) // loop 1
+  for ( size_t iroi = 0; iroi < cluster.NROIs(); iroi++ ) // loop 1
   {
+    auto &roi = cluster.ROI(iroi);
     int roi_channel = roi.wire->Channel();
     if (fLogLevel>=10) 
     {
@@ -1299,22 +1413,22 @@ wireana::WireAna::WriteNumPy( wireana::matchedroicluster& cluster,  std::vector<
   c2numpy_uint16(&npywriter, (unsigned int) cluster.labelmatch() );
   c2numpy_uint16(&npywriter, (unsigned int) cluster.trkmatch());
 
-  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0].n_photon );
-  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0].n_proton );
-  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0].n_neutron);
-  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0].n_meson  );
-  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0].n_nucleus);
+  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0]->n_photon );
+  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0]->n_proton );
+  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0]->n_neutron);
+  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0]->n_meson  );
+  c2numpy_uint16(&npywriter, (unsigned int) cluster.clusters[0]->n_nucleus);
 
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_neutrino.Px() );
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_neutrino.Py() );
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_neutrino.Pz() );
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_part.Px() );
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_part.Py() );
-  c2numpy_float(&npywriter, cluster.clusters[0].momentum_part.Pz() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_neutrino.Px() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_neutrino.Py() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_neutrino.Pz() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_part.Px() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_part.Py() );
+  c2numpy_float(&npywriter, cluster.clusters[0]->momentum_part.Pz() );
 
-  std::vector<double> u_vec = GetArrayFromWire( wirelist, cluster.clusters[0], image_channel_width, image_tick_width );
-  std::vector<double> v_vec = GetArrayFromWire( wirelist, cluster.clusters[1], image_channel_width, image_tick_width );
-  std::vector<double> z_vec = GetArrayFromWire( wirelist, cluster.clusters[2], image_channel_width, image_tick_width );
+  std::vector<double> u_vec = GetArrayFromWire( wirelist, *cluster.clusters[0], image_channel_width, image_tick_width );
+  std::vector<double> v_vec = GetArrayFromWire( wirelist, *cluster.clusters[1], image_channel_width, image_tick_width );
+  std::vector<double> z_vec = GetArrayFromWire( wirelist, *cluster.clusters[2], image_channel_width, image_tick_width );
 
   std::shared_ptr<std::vector<double>> u_vecc = std::make_shared< std::vector<double> >( CombineTicks( u_vec, image_channel_width, image_rebin_tick )) ;
   std::shared_ptr<std::vector<double>> v_vecc = std::make_shared< std::vector<double> >( CombineTicks( v_vec, image_channel_width, image_rebin_tick )) ;
@@ -1323,14 +1437,25 @@ wireana::WireAna::WriteNumPy( wireana::matchedroicluster& cluster,  std::vector<
   std::vector< std::shared_ptr<std::vector<double>> > vecc({ u_vecc,
                                                              v_vecc,
                                                              z_vecc } ); 
-  for( int i = 0; i < image_size; i++ )
+  if( fDumpImageColumns )
   {
-    for( int v = 0; v < 3; v++ )
+    for( int i = 0; i < image_size; i++ )
     {
-      std::string name=Form("%s_%08d", fViewMap[v].c_str(),i);
-      c2numpy_float(&npywriter, vecc[v]->at(i) );
+      for( int v = 0; v < 3; v++ )
+      {
+        c2numpy_float(&npywriter, vecc[v]->at(i) );
+      }
     }
   }
+
+  //images in view, tick, channel order
+  std::vector<float> images( 3*image_size, 0 );
+  for( int v = 0; v < 3; v++ )
+  {
+    int n = std::min( image_size, (int) vecc[v]->size() );
+    for( int i = 0; i < n; i++ ) images[v*image_size+i] = vecc[v]->at(i);
+  }
+  imagewriter.Append( images );
 }
 
 //============================ Histogram Functions ================================
@@ -46,6 +46,11 @@
 
 #include "c2numpy.h"
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
+#include <functional>
+
 // ROOT includes
 #include "TTree.h"
 #include "TH1F.h"
@@ -152,6 +157,11 @@ private:
   float fPitch;
 
   float fDeltaMetric;
+  int fMatchTickTolerance;
+  bool fUseDeltaC;
+  std::string fCrossingCacheFile;
+  wireana::WireCrossingTable fCrossingTable; //job-wide wire crossing lookup, one shard per APA
+  bool fParallelAPAs;
 
   int image_channel_width;
   int image_tick_width;
@@ -177,14 +187,17 @@ private:
   std::vector<wireana::wirecluster> BuildInitialClusters( std::vector<art::Ptr<recob::Wire>> &vec, int dW, int dTick );
 
 
+  void RunPerAPA( const std::vector<int> &apas, const std::function<void(int)> &task );
   void BuildPlaneViewROIMap(  std::vector<art::Ptr<recob::Wire>> &wires );
   void BuildInitialROIClusters();
+  std::vector<wireana::matchedroicluster> MatchROIClusters( geo::GeometryCore const* geom );
   std::vector<art::Ptr<recob::Wire>> FilterWires(std::vector<art::Ptr<recob::Wire>> &vec, int dC1, int dT1, int dCn, int dTn );
   bool HasHit( const art::Ptr<recob::Wire> &wire, int minTick );
 
 
   void PrintClusters( std::vector<wirecluster> &clusters );
   void PrintROIs( const std::vector<roi> &ROIs);
+  void PrintROIs( const roicluster &cluster );
 
   void WriteNumPy( matchedroicluster& cluster, std::vector<art::Ptr<recob::Wire>>& wirelist );
 
@@ -242,6 +255,7 @@ private:
 
   std::string fDumpFileName;
   int fDumpMaxRow;
+  bool fDumpImageColumns;
   int fDumpNClusters;
 
   std::string fTreeName;
@@ -291,6 +305,7 @@ private:
   std::map<int, std::string> fViewMap;
 
   c2numpy_writer npywriter;
+  wireana::numpywriter imagewriter; //images as one float32 (N, 3, ticks, channels) array
 
 };
 